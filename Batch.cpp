@@ -0,0 +1,192 @@
+#include "Batch.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <dirent.h>
+#include <sys/stat.h>
+
+using std::cerr;
+
+namespace {
+    // A position to analyze: the path of a save file, a FEN/EPD line or a binary record
+    struct BatchPosition {
+        enum Kind { SaveFile, Fen, Record };
+
+        string name;
+        Kind kind;
+        string text;
+        PositionRecord record;
+    };
+
+    bool endsWith(const string &text, const string &suffix) {
+        return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    bool isDirectory(const string &path) {
+        struct stat status;
+        return stat(path.c_str(), &status) == 0 && S_ISDIR(status.st_mode);
+    }
+
+    // An older save file starts with a line holding only whose turn it is, the newer ones are FEN lines
+    bool isSaveFile(const string &path) {
+        ifstream input(path.c_str());
+        string firstLine;
+        getline(input, firstLine);
+        while(!firstLine.empty() && isspace(static_cast<unsigned char>(firstLine.back())))
+            firstLine.pop_back();
+        return firstLine == "0" || firstLine == "1";
+    }
+
+    // The name of an EPD position is its id operation (id "name";), otherwise the file and the line number
+    string positionName(const string &line, const string &path, int lineNumber) {
+        size_t id = line.find("id \"");
+        if(id != string::npos) {
+            size_t end = line.find('"', id + 4);
+            if(end != string::npos)
+                return line.substr(id + 4, end - id - 4);
+        }
+        return path + ":" + std::to_string(lineNumber);
+    }
+
+    // Adds the positions of the path to the list, returns false if it can't be read
+    bool collectPositions(const string &path, vector<BatchPosition> &positions) {
+        if(isDirectory(path)) {
+            DIR *directory = opendir(path.c_str());
+            if(directory == nullptr)
+                return false;
+
+            // Sorted, so the same directory always gives the positions in the same order
+            vector<string> fileNames;
+            while(dirent *entry = readdir(directory)) {
+                string fileName = entry->d_name;
+                if(endsWith(fileName, ".txt"))
+                    fileNames.push_back(path + "/" + fileName);
+            }
+            closedir(directory);
+            std::sort(fileNames.begin(), fileNames.end());
+
+            for(const string &fileName : fileNames) {
+                if(!collectPositions(fileName, positions))
+                    return false;
+            }
+            return true;
+        }
+
+        // Files of binary records (see PositionRecord in Board.h)
+        if(endsWith(path, ".bin")) {
+            vector<PositionRecord> records;
+            if(!readPositionRecords(path, records))
+                return false;
+            for(size_t i=0; i<records.size(); ++i)
+                positions.push_back({ path + ":" + std::to_string(i + 1), BatchPosition::Record, string(), records[i] });
+            return true;
+        }
+
+        ifstream input(path.c_str());
+        if(!input.is_open())
+            return false;
+
+        if(isSaveFile(path)) {
+            positions.push_back({ path, BatchPosition::SaveFile, path, PositionRecord() });
+            return true;
+        }
+
+        // One FEN or EPD position per line, empty lines and lines starting with # are skipped
+        string line;
+        int lineNumber = 0;
+        while(getline(input, line)) {
+            ++lineNumber;
+            if(line.find_first_not_of(" \t\r") == string::npos || line[line.find_first_not_of(" \t")] == '#')
+                continue;
+            positions.push_back({ positionName(line, path, lineNumber), BatchPosition::Fen, line, PositionRecord() });
+        }
+        return true;
+    }
+
+    string scoreToString(int score) {
+        if(Search::isMateScore(score))
+            return "mate " + std::to_string(Search::movesToMate(score));
+        return std::to_string(score);
+    }
+}
+
+bool runBatch(const BatchOptions &options, std::ostream &output) {
+    bool allRead = true;
+    vector<BatchPosition> positions;
+    for(const string &path : options.paths) {
+        if(!collectPositions(path, positions)) {
+            cerr << "Can't read " << path << "\n";
+            allRead = false;
+        }
+    }
+
+    int jobs = options.jobs > 0 ? options.jobs : static_cast<int>(std::thread::hardware_concurrency());
+    if(jobs < 1)
+        jobs = 1;
+    if(jobs > static_cast<int>(positions.size()))
+        jobs = std::max(1, static_cast<int>(positions.size()));
+
+    // Every thread takes the next position nobody took yet until there are none left
+    std::atomic<size_t> nextPosition(0);
+    std::atomic<uint64_t> totalNodes(0);
+    std::atomic<bool> allValid(true);
+    std::mutex outputMutex;
+
+    auto analyze = [&]() {
+        Board board;
+        Search search;
+        search.setThreads(options.threadsPerSearch);
+        search.setTablebases(options.tablebases);
+        if(options.hashSize > 0)
+            search.setHashSize(options.hashSize);
+
+        for(size_t i = nextPosition++; i < positions.size(); i = nextPosition++) {
+            const BatchPosition &position = positions[i];
+            bool valid;
+            if(position.kind == BatchPosition::SaveFile)
+                valid = board.loadSave(position.text) != -1;
+            else if(position.kind == BatchPosition::Fen)
+                valid = board.setFromFen(position.text);
+            else
+                valid = board.setFromRecord(position.record);
+            if(!valid) {
+                std::lock_guard<std::mutex> lock(outputMutex);
+                cerr << "Invalid position " << position.name << "\n";
+                allValid = false;
+                continue;
+            }
+
+            // The positions have nothing to do with each other, the results of the last one would only fill the table
+            search.clearHash();
+            SearchResult result = search.think(board, options.limits);
+            totalNodes += result.nodes;
+
+            std::ostringstream line;
+            line << position.name << ','
+                 << (result.bestMove.from == result.bestMove.to ? string("none") : moveToString(result.bestMove)) << ','
+                 << scoreToString(result.score) << ',' << result.depth << ',' << result.nodes << ','
+                 << static_cast<uint64_t>(result.seconds * 1000);
+
+            std::lock_guard<std::mutex> lock(outputMutex);
+            output << line.str() << endl;
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    output << "position,bestmove,score,depth,nodes,milliseconds" << endl;
+
+    vector<std::thread> threads;
+    for(int i=1; i<jobs; ++i)
+        threads.emplace_back(analyze);
+    analyze();
+    for(std::thread &thread : threads)
+        thread.join();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    cerr << positions.size() << " positions in " << seconds << " s with " << jobs << " threads, " << totalNodes
+         << " nodes (" << static_cast<uint64_t>(seconds > 0 ? totalNodes / seconds : 0) << " nodes/s)\n";
+
+    return allRead && allValid;
+}
@@ -0,0 +1,31 @@
+/* Batch analysis: searches a list of positions without the interactive prompt and writes one result line per position.
+ * Positions come from save files, from files with one FEN or EPD position per line, or from .bin files of binary
+ * records (see PositionRecord in Board.h). A directory stands for every .txt file in it. The positions are shared out to a pool of threads, each with its
+ * own board and search, so the throughput grows with the number of cores. */
+
+#ifndef CHESS_BATCH_H
+#define CHESS_BATCH_H
+
+#include <ostream>
+#include "Board.h"
+#include "Search.h"
+
+struct BatchOptions {
+    vector<string> paths;   // Save files, FEN/EPD files, record files or directories of them
+    SearchLimits limits;    // Budget of each position
+    int jobs;               // Positions searched at the same time, 0 for one per core
+    int threadsPerSearch;
+    int hashSize;           // Megabytes of the transposition table of each search, 0 for the default
+    const Tablebases *tablebases;   // Endgame tables shared by the searches, nullptr for none
+
+    BatchOptions() : jobs(0), threadsPerSearch(1), hashSize(0), tablebases(nullptr) {}
+};
+
+// Analyzes the positions of the paths and writes a line for each to the output as soon as it is done (so the lines are
+// in the order the positions finish, not the order they were read). Lines are comma separated like the save files:
+//   position,bestmove,score,depth,nodes,milliseconds
+// The score is in centipawns for the side to move, or "mate N" (negative when the side to move gets mated).
+// Errors and a summary go to std::cerr. Returns false if a path or a position could not be read.
+bool runBatch(const BatchOptions &options, std::ostream &output);
+
+#endif //CHESS_BATCH_H
@@ -0,0 +1,265 @@
+#include "Bitboard.h"
+
+// PEXT (parallel bit extract, part of BMI2) turns the occupancy of a slider's rays straight into a table index.
+// It is compiled in on x86-64 with GCC or Clang and used if the CPU running the program has it.
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define CHESS_HAS_PEXT 1
+#else
+#define CHESS_HAS_PEXT 0
+#endif
+
+namespace {
+    // Row and col steps of the 8 ray directions. The first 4 directions increase the square index, the last 4 decrease it.
+    const int rayRowStep[8] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+    const int rayColStep[8] = { 1, -1, 0, 1, -1, 1, 0, -1 };
+
+    // Diagonal directions of the tables above for bishops, straight directions for rooks
+    const int bishopDirections[4] = { 1, 3, 5, 7 };
+    const int rookDirections[4] = { 0, 2, 4, 6 };
+
+    Bitboard pawnAttackTable[2][64];
+    Bitboard knightAttackTable[64];
+    Bitboard kingAttackTable[64];
+    Bitboard rayTable[8][64];
+    Bitboard betweenTable[64][64];
+
+    // Attacks of a slider on one square for every occupancy of its rays. Only the occupancy of the mask matters (the
+    // rays without the board's edge, a piece on the edge can't block anything behind it). The index of an occupancy is
+    // ((occupied & mask) * magic) >> shift, or with PEXT the bits of the mask in occupied packed together.
+    struct SliderTable {
+        Bitboard mask;
+        Bitboard magic;
+        int shift;
+        Bitboard *attacks;
+    };
+
+    SliderTable bishopTables[64];
+    SliderTable rookTables[64];
+    // Every square's attack sets one after the other, 2^(bits of the mask) of them for each square
+    Bitboard bishopAttackTable[5248];
+    Bitboard rookAttackTable[102400];
+
+    SliderLookup lookup = SliderLookup::Magic;
+
+    bool onBoard(int row, int col) {
+        return row >= 0 && row < 8 && col >= 0 && col < 8;
+    }
+
+    // Returns the bitboard of the squares reached from the square with the given row and col steps (only one step each)
+    Bitboard stepAttacks(int square, const int rowSteps[], const int colSteps[], int count) {
+        Bitboard attacks = 0;
+        for(int i=0; i<count; ++i) {
+            int row = rowOf(square) + rowSteps[i];
+            int col = colOf(square) + colSteps[i];
+            if(onBoard(row, col))
+                attacks |= squareBit(toSquare(row, col));
+        }
+        return attacks;
+    }
+
+    // Returns the attacks along one ray, stopping at the first occupied square
+    Bitboard rayAttacks(int square, int direction, Bitboard occupied) {
+        Bitboard attacks = rayTable[direction][square];
+        Bitboard blockers = attacks & occupied;
+        if(blockers) {
+            // The first blocker is the closest one to the square, which depends on the direction of the ray
+            int blocker = direction < 4 ? lowestSquare(blockers) : highestSquare(blockers);
+            attacks ^= rayTable[direction][blocker];
+        }
+        return attacks;
+    }
+
+    // Attacks of a slider found by following its rays, used to fill the lookup tables
+    Bitboard slowAttacks(int square, Bitboard occupied, const int directions[4]) {
+        Bitboard attacks = 0;
+        for(int i=0; i<4; ++i)
+            attacks |= rayAttacks(square, directions[i], occupied);
+        return attacks;
+    }
+
+    // Magic numbers of each square. They were found by trying random numbers with few bits set until one mapped every
+    // occupancy of the mask to an index without two different attack sets colliding.
+    const Bitboard bishopMagics[64] = {
+        0x2008021012002502ULL, 0x04D0100110628400ULL, 0x21102080A1021010ULL, 0x2044041080000400ULL,
+        0x0004050402800000ULL, 0x0002010420109560ULL, 0x08040084500A0000ULL, 0x9401002104224008ULL,
+        0x40044350070B0100ULL, 0x90B00888088C1040ULL, 0x0100100440444012ULL, 0x80001104008A0940ULL,
+        0x1042920210504048ULL, 0x0000010420048200ULL, 0x000000A410221000ULL, 0x804800829C901001ULL,
+        0x0040002008010120ULL, 0x8802008424280205ULL, 0x200800010A040010ULL, 0x2420800802004008ULL,
+        0x0012011402A21220ULL, 0x2002028508022208ULL, 0x0486200049100802ULL, 0x2000211101080200ULL,
+        0x8020200044140C60ULL, 0x0810680C05080381ULL, 0x0001442028012400ULL, 0x4028088008020002ULL,
+        0x25C1001041004010ULL, 0x0401020049080140ULL, 0x0004004084210400ULL, 0x40010900104400A0ULL,
+        0x011011480004A800ULL, 0x0082020200A0680BULL, 0x0800203000080082ULL, 0x0005020081880080ULL,
+        0x1050120080001004ULL, 0x0020008880030810ULL, 0x2241180900008C30ULL, 0x0201451101012400ULL,
+        0x8444016008025000ULL, 0x0002080104000800ULL, 0x2801001490090200ULL, 0x0500142018001100ULL,
+        0x0300040408200400ULL, 0x0008008800820810ULL, 0x0804210204004212ULL, 0x000800A698800202ULL,
+        0x0411040202401000ULL, 0x0A008C051802000EULL, 0x1002A100A8040022ULL, 0x00000C0084042600ULL,
+        0x1000884048220000ULL, 0x0082200410208000ULL, 0x0222020441140022ULL, 0x1004080800408810ULL,
+        0x0022410801500201ULL, 0x010000410818020BULL, 0x2044000044040410ULL, 0x00200C0100208801ULL,
+        0x080800200A102400ULL, 0x000404C010020090ULL, 0x1002101418808C03ULL, 0x0011300081040020ULL
+    };
+
+    const Bitboard rookMagics[64] = {
+        0xA680042040001480ULL, 0x40C0014010002000ULL, 0x0200100820804202ULL, 0x0900100008210004ULL,
+        0x4A00108402000820ULL, 0x2200040200018810ULL, 0x03000100220008ACULL, 0x4080002044800D00ULL,
+        0x008C800080400820ULL, 0x400240012002D000ULL, 0x0001001041002008ULL, 0x0110801000080080ULL,
+        0x0001000500100800ULL, 0x8A46000408020010ULL, 0x00040010084104A2ULL, 0x014A000220804401ULL,
+        0x80102A8000400088ULL, 0x0020008020804000ULL, 0x4010008010200081ULL, 0x0208010100100020ULL,
+        0x2091010008001005ULL, 0x0002008080020400ULL, 0x240024001110C208ULL, 0x0400120001008054ULL,
+        0x8080208080004004ULL, 0x80DD5004C0042000ULL, 0x0410040120080120ULL, 0x2000D00180380080ULL,
+        0x0008000880040080ULL, 0x100A000200080410ULL, 0x0300080400100102ULL, 0x6200008200011044ULL,
+        0x061481400C800060ULL, 0x1001004001002084ULL, 0x0000200080801000ULL, 0x840010010100200BULL,
+        0x0028040080800800ULL, 0x0882000406001830ULL, 0x0001005421001200ULL, 0x000001804600010CULL,
+        0x0000804000208000ULL, 0x4400402010044000ULL, 0x4010008020028014ULL, 0x0000090410010020ULL,
+        0x0000080100110005ULL, 0x0A00201004080140ULL, 0x0000040200010100ULL, 0x0220007081020004ULL,
+        0x840205C981002A00ULL, 0x0000804000200480ULL, 0x0002081040802200ULL, 0x0240230010000900ULL,
+        0x0044800800240180ULL, 0x4011000400080300ULL, 0x00101011088A0C00ULL, 0x1003000080420100ULL,
+        0x0180102100408001ULL, 0x1100108040010021ULL, 0x0182004008108022ULL, 0x0122900128202501ULL,
+        0x0002012004100802ULL, 0x00C200834C081002ULL, 0x0440020110083084ULL, 0x4000484884010022ULL
+    };
+
+#if CHESS_HAS_PEXT
+    __attribute__((target("bmi2"))) uint64_t parallelExtract(uint64_t value, uint64_t mask) {
+        return _pext_u64(value, mask);
+    }
+#endif
+
+    size_t tableIndex(const SliderTable &table, Bitboard occupied) {
+#if CHESS_HAS_PEXT
+        if(lookup == SliderLookup::Pext)
+            return parallelExtract(occupied, table.mask);
+#endif
+        return ((occupied & table.mask) * table.magic) >> table.shift;
+    }
+
+    // Fills the attack sets of every square for one kind of slider
+    void buildSliderTables(SliderTable tables[64], Bitboard attackTable[], const int directions[4], const Bitboard magics[64]) {
+        Bitboard *next = attackTable;
+
+        for(int square=0; square<64; ++square) {
+            SliderTable &table = tables[square];
+
+            // The edges only count if the slider stands on them (then the rays run along the edge)
+            Bitboard edges = ((rowMask(0) | rowMask(7)) & ~rowMask(rowOf(square)))
+                             | ((fileMask(0) | fileMask(7)) & ~fileMask(colOf(square)));
+            table.mask = slowAttacks(square, 0, directions) & ~edges;
+            table.magic = magics[square];
+            table.shift = 64 - popCount(table.mask);
+            table.attacks = next;
+            next += 1 << popCount(table.mask);
+
+            // Every subset of the mask (carry-rippler trick) gets the attacks for it
+            Bitboard subset = 0;
+            do {
+                table.attacks[tableIndex(table, subset)] = slowAttacks(square, subset, directions);
+                subset = (subset - table.mask) & table.mask;
+            } while(subset);
+        }
+    }
+
+    void buildSliders() {
+        buildSliderTables(bishopTables, bishopAttackTable, bishopDirections, bishopMagics);
+        buildSliderTables(rookTables, rookAttackTable, rookDirections, rookMagics);
+    }
+
+    bool cpuHasPext() {
+#if CHESS_HAS_PEXT
+        // Some AMD processors before Zen 3 have PEXT but run it very slowly, they are not told apart here
+        return __builtin_cpu_supports("bmi2");
+#else
+        return false;
+#endif
+    }
+
+    void buildTables() {
+        const int knightRows[8] = { -2, -2, -1, -1, 1, 1, 2, 2 };
+        const int knightCols[8] = { -1, 1, -2, 2, -2, 2, -1, 1 };
+        const int kingRows[8] = { -1, -1, -1, 0, 0, 1, 1, 1 };
+        const int kingCols[8] = { -1, 0, 1, -1, 1, -1, 0, 1 };
+        // White pawns move towards row 0, black pawns towards row 7
+        const int whitePawnRows[2] = { -1, -1 };
+        const int blackPawnRows[2] = { 1, 1 };
+        const int pawnCols[2] = { -1, 1 };
+
+        for(int square=0; square<64; ++square) {
+            knightAttackTable[square] = stepAttacks(square, knightRows, knightCols, 8);
+            kingAttackTable[square] = stepAttacks(square, kingRows, kingCols, 8);
+            pawnAttackTable[0][square] = stepAttacks(square, whitePawnRows, pawnCols, 2);
+            pawnAttackTable[1][square] = stepAttacks(square, blackPawnRows, pawnCols, 2);
+
+            for(int direction=0; direction<8; ++direction) {
+                Bitboard ray = 0;
+                int row = rowOf(square) + rayRowStep[direction];
+                int col = colOf(square) + rayColStep[direction];
+                while(onBoard(row, col)) {
+                    ray |= squareBit(toSquare(row, col));
+                    row += rayRowStep[direction];
+                    col += rayColStep[direction];
+                }
+                rayTable[direction][square] = ray;
+            }
+        }
+
+        // Squares between two squares on the same row, col or diagonal: the ray from one of them up to the other
+        for(int from=0; from<64; ++from) {
+            for(int to=0; to<64; ++to) {
+                betweenTable[from][to] = 0;
+                for(int direction=0; direction<8; ++direction) {
+                    if(rayTable[direction][from] & squareBit(to))
+                        betweenTable[from][to] = rayTable[direction][from] & ~rayTable[direction][to] & ~squareBit(to);
+                }
+            }
+        }
+
+        lookup = cpuHasPext() ? SliderLookup::Pext : SliderLookup::Magic;
+        buildSliders();
+    }
+}
+
+void initBitboards() {
+    // Function-local static is initialized exactly once, even when several boards are created at the same time
+    static const bool initialized = (buildTables(), true);
+    (void)initialized;
+}
+
+Bitboard pawnAttacks(int color, int square) {
+    return pawnAttackTable[color][square];
+}
+
+Bitboard knightAttacks(int square) {
+    return knightAttackTable[square];
+}
+
+Bitboard kingAttacks(int square) {
+    return kingAttackTable[square];
+}
+
+Bitboard bishopAttacks(int square, Bitboard occupied) {
+    const SliderTable &table = bishopTables[square];
+    return table.attacks[tableIndex(table, occupied)];
+}
+
+Bitboard rookAttacks(int square, Bitboard occupied) {
+    const SliderTable &table = rookTables[square];
+    return table.attacks[tableIndex(table, occupied)];
+}
+
+Bitboard betweenSquares(int from, int to) {
+    return betweenTable[from][to];
+}
+
+SliderLookup sliderLookup() {
+    return lookup;
+}
+
+bool setSliderLookup(SliderLookup newLookup) {
+    initBitboards();
+    if(newLookup == SliderLookup::Pext && !cpuHasPext())
+        return false;
+
+    if(newLookup != lookup) {
+        lookup = newLookup;
+        buildSliders();
+    }
+    return true;
+}
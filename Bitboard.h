@@ -0,0 +1,71 @@
+/* Bitboard helpers for the Board class.
+ * A bitboard is a 64-bit mask with one bit per square of the chess board.
+ * Squares are numbered row * 8 + col, with the same rows and columns as the board vector used to have,
+ * so square 0 is a8 (top left when printed) and square 63 is h1. */
+
+#ifndef CHESS_BITBOARD_H
+#define CHESS_BITBOARD_H
+
+#include <cstdint>
+
+typedef uint64_t Bitboard;
+
+// Converts a row and col of the board into a square index and back
+inline int toSquare(int row, int col) { return row * 8 + col; }
+inline int rowOf(int square) { return square >> 3; }
+inline int colOf(int square) { return square & 7; }
+
+// Returns a bitboard with only the given square set
+inline Bitboard squareBit(int square) { return 1ULL << square; }
+
+// Returns a bitboard with every square of the row set
+inline Bitboard rowMask(int row) { return 0xFFULL << (row * 8); }
+
+// Returns a bitboard with every square of the col set
+inline Bitboard fileMask(int col) { return 0x0101010101010101ULL << col; }
+
+// Returns the number of set squares of the bitboard
+inline int popCount(Bitboard b) { return __builtin_popcountll(b); }
+
+// Precondition: b is not 0. Returns the lowest set square of the bitboard.
+inline int lowestSquare(Bitboard b) { return __builtin_ctzll(b); }
+
+// Precondition: b is not 0. Returns the highest set square of the bitboard.
+inline int highestSquare(Bitboard b) { return 63 - __builtin_clzll(b); }
+
+// Precondition: b is not 0. Removes the lowest set square from the bitboard and returns it.
+inline int popLowestSquare(Bitboard &b) {
+    int square = lowestSquare(b);
+    b &= b - 1;
+    return square;
+}
+
+// Fills the attack tables below. Safe to call more than once, the tables are only built the first time.
+void initBitboards();
+
+// Squares attacked by a pawn of the given color (0 for white, 1 for black) standing on the square
+Bitboard pawnAttacks(int color, int square);
+
+// Squares attacked by a knight or a king standing on the square
+Bitboard knightAttacks(int square);
+Bitboard kingAttacks(int square);
+
+// Squares attacked by a sliding piece on the square, rays stop at (and include) the first occupied square.
+// Each one is a single lookup in a table indexed by the occupancy of the piece's rays (magic bitboards or PEXT).
+Bitboard bishopAttacks(int square, Bitboard occupied);
+Bitboard rookAttacks(int square, Bitboard occupied);
+
+// Squares strictly between the two squares if they are on the same row, col or diagonal, otherwise 0
+Bitboard betweenSquares(int from, int to);
+
+// How the slider tables are indexed: a multiplication by a magic number, or the PEXT instruction of BMI2 CPUs.
+// PEXT is used when the CPU has it.
+enum class SliderLookup { Magic, Pext };
+
+SliderLookup sliderLookup();
+
+// Rebuilds the slider tables for the lookup, returns false (and changes nothing) if the CPU can't do PEXT.
+// Meant for benchmarks: not safe while another thread is using the tables.
+bool setSliderLookup(SliderLookup lookup);
+
+#endif //CHESS_BITBOARD_H
@@ -1,50 +1,202 @@
 #include "Board.h"
+#include <random>
+#include "OpeningBook.h"
+#include "Search.h"
+#include "TranspositionTable.h"
+
+namespace {
+    // Returns the piece of the FEN letter (uppercase for white, lowercase for black), an Empty piece for other letters
+    Piece pieceFromSymbol(char symbol) {
+        int color = isupper(static_cast<unsigned char>(symbol)) ? 0 : 1;
+        switch(tolower(static_cast<unsigned char>(symbol))) {
+            case 'p': return Piece(PieceType::Pawn, color);
+            case 'r': return Piece(PieceType::Rook, color);
+            case 'n': return Piece(PieceType::Knight, color);
+            case 'b': return Piece(PieceType::Bishop, color);
+            case 'q': return Piece(PieceType::Queen, color);
+            case 'k': return Piece(PieceType::King, color);
+            default: return Piece();
+        }
+    }
+}
+
+string moveToString(const Move &move) {
+    string notation;
+    notation += static_cast<char>(colOf(move.from) + 'a');
+    notation += static_cast<char>('8' - rowOf(move.from));
+    notation += static_cast<char>(colOf(move.to) + 'a');
+    notation += static_cast<char>('8' - rowOf(move.to));
+
+    // Lowercase symbol of the promotion piece
+    if(move.promotion != PieceType::Empty)
+        notation += static_cast<char>(tolower(Piece(move.promotion).getSymbol()));
+
+    return notation;
+}
 
 Board::Board() {
+    // Attack tables and hash keys are shared by all the boards, they are only built once
+    initBitboards();
+    initZobrist();
+    initEvaluation();
     createBoard();
 }
 
 void Board::createBoard() {
-    // Resize the board vector to have 8x8 slots for pieces. (Defaults them to Piece constructor's default values)
-    board.resize(8, vector<Piece>(8));
+    // Start from an empty board, then put the pieces into their starting state
+    clearBoard();
 
-    // Put the pieces into their starting state
     // Pawns for white and black
     for(int x=0; x<8; ++x) {
-        board[1][x] = Piece(PieceType::Pawn, 1);
-        board[6][x] = Piece(PieceType::Pawn, 0);
+        placePiece(toSquare(1, x), Piece(PieceType::Pawn, 1));
+        placePiece(toSquare(6, x), Piece(PieceType::Pawn, 0));
+    }
+
+    // Rest of the pieces, the same order for white (color=0, row 7) and black (color=1, row 0)
+    const PieceType backRank[8] = { PieceType::Rook, PieceType::Knight, PieceType::Bishop, PieceType::Queen,
+                                    PieceType::King, PieceType::Bishop, PieceType::Knight, PieceType::Rook };
+    for(int x=0; x<8; ++x) {
+        placePiece(toSquare(7, x), Piece(backRank[x], 0));
+        placePiece(toSquare(0, x), Piece(backRank[x], 1));
     }
 
-    // Rest of the white pieces (color=0)
-    board[7][0] = Piece(PieceType::Rook, 0);
-    board[7][7] = Piece(PieceType::Rook, 0);
-    board[7][1] = Piece(PieceType::Knight, 0);
-    board[7][6] = Piece(PieceType::Knight, 0);
-    board[7][2] = Piece(PieceType::Bishop, 0);
-    board[7][5] = Piece(PieceType::Bishop, 0);
-    board[7][3] = Piece(PieceType::Queen, 0);
-    board[7][4] = Piece(PieceType::King, 0);
+    computeAttackMaps();
+    hashKey = computeHashKey();
+}
 
+void Board::clearBoard() {
+    // Empty all the bitboards, every square will be read as an Empty piece.
+    for(int color=0; color<2; ++color) {
+        for(int type=0; type<6; ++type)
+            pieces[color][type] = 0;
+        colorOccupancy[color] = 0;
+    }
+    occupancy = 0;
+    movedPieces = 0;
+    mailbox.fill(Piece().getCode());
+    enPassantSquare = -1;
+    sideToMove = 0;
+    halfmoveClock = 0;
+    fullmoveNumber = 1;
+    hashKey = 0;
+    for(int color=0; color<2; ++color) {
+        middlegameScore[color] = 0;
+        endgameScore[color] = 0;
+    }
+    gamePhase = 0;
 
-    // Rest of the black pieces (color=1)
-    board[0][0] = Piece(PieceType::Rook, 1);
-    board[0][7] = Piece(PieceType::Rook, 1);
-    board[0][1] = Piece(PieceType::Knight, 1);
-    board[0][6] = Piece(PieceType::Knight, 1);
-    board[0][2] = Piece(PieceType::Bishop, 1);
-    board[0][5] = Piece(PieceType::Bishop, 1);
-    board[0][3] = Piece(PieceType::Queen, 1);
-    board[0][4] = Piece(PieceType::King, 1);
+    // No pieces in the lists, no Kings on the board
+    for(int color=0; color<2; ++color) {
+        pieceCount[color] = 0;
+        kingSquare[color] = -1;
+    }
+    for(int square=0; square<64; ++square)
+        pieceIndex[square] = -1;
 
-    // Initialize previous board as same as the default board
-    previousBoard = board;
+    // Moves made before can't be taken back on a new board. Room is kept for a whole game and a search after it, so
+    // makeMove doesn't allocate (the constructor, setFromFen and loadSave all come here).
+    history.clear();
+    history.reserve(UNDO_CAPACITY);
 }
 
-void Board::clearBoard() {
-    // Resize the board vector to have 8x8 slots for pieces.
-    // Each Piece will be defaulted to Empty via the Piece's constructor.
-    board.clear();
-    board.resize(8, vector<Piece>(8));
+Piece Board::getPiece(int row, int col) const {
+    return Piece::fromCode(mailbox[toSquare(row, col)]);
+}
+
+void Board::placePiece(int square, const Piece &piece) {
+    Bitboard bit = squareBit(square);
+    int color = piece.getColor();
+
+    pieces[color][static_cast<int>(piece.getType())] |= bit;
+    colorOccupancy[color] |= bit;
+    occupancy |= bit;
+    if(piece.gethasMoved())
+        movedPieces |= bit;
+    mailbox[square] = piece.getCode();
+
+    // Add the square to the end of the color's piece list
+    pieceIndex[square] = static_cast<int8_t>(pieceCount[color]);
+    pieceList[color][pieceCount[color]++] = static_cast<uint8_t>(square);
+    if(piece.getType() == PieceType::King)
+        kingSquare[color] = square;
+
+    int type = static_cast<int>(piece.getType());
+    hashKey ^= zobristPiece(color, type, square);
+    middlegameScore[color] += middlegameValue(color, type, square);
+    endgameScore[color] += endgameValue(color, type, square);
+    gamePhase += phaseValue(type);
+}
+
+void Board::removePiece(int square) {
+    Bitboard bit = squareBit(square);
+    if(!(occupancy & bit))
+        return;
+
+    // The last square of the piece list takes the place of the removed one, so the list has no gaps
+    int color = (colorOccupancy[0] & bit) ? 0 : 1;
+    int lastSquare = pieceList[color][--pieceCount[color]];
+    pieceList[color][pieceIndex[square]] = static_cast<uint8_t>(lastSquare);
+    pieceIndex[lastSquare] = pieceIndex[square];
+    pieceIndex[square] = -1;
+
+    if(kingSquare[color] == square)
+        kingSquare[color] = -1;
+
+    // The type is needed to take the piece's key and values out of the hash key and the scores
+    int type = static_cast<int>(Piece::fromCode(mailbox[square]).getType());
+    mailbox[square] = Piece().getCode();
+    hashKey ^= zobristPiece(color, type, square);
+    middlegameScore[color] -= middlegameValue(color, type, square);
+    endgameScore[color] -= endgameValue(color, type, square);
+    gamePhase -= phaseValue(type);
+
+    pieces[color][type] &= ~bit;
+    colorOccupancy[color] &= ~bit;
+    occupancy &= ~bit;
+    movedPieces &= ~bit;
+}
+
+int Board::castlingRights() const {
+    int rights = 0;
+    // Bits 1 and 2 for white (King on e1, row 7), bits 4 and 8 for black (King on e8, row 0)
+    for(int color=0; color<2; ++color) {
+        int row = color == 0 ? 7 : 0;
+        int kingFrom = toSquare(row, 4);
+        if(!(pieces[color][static_cast<int>(PieceType::King)] & ~movedPieces & squareBit(kingFrom)))
+            continue;
+
+        Bitboard unmovedRooks = pieces[color][static_cast<int>(PieceType::Rook)] & ~movedPieces;
+        if(unmovedRooks & squareBit(toSquare(row, 7)))
+            rights |= 1 << (color * 2);
+        if(unmovedRooks & squareBit(toSquare(row, 0)))
+            rights |= 2 << (color * 2);
+    }
+    return rights;
+}
+
+uint64_t Board::stateHashKey() const {
+    uint64_t key = zobristCastling(castlingRights());
+    if(sideToMove == 1)
+        key ^= zobristSide();
+
+    // The square can only be captured on by a pawn standing where an opponent pawn would attack it from
+    int opponent = sideToMove == 0 ? 1 : 0;
+    if(enPassantSquare >= 0 && (pawnAttacks(opponent, enPassantSquare) & pieces[sideToMove][static_cast<int>(PieceType::Pawn)]))
+        key ^= zobristEnPassant(colOf(enPassantSquare));
+
+    return key;
+}
+
+uint64_t Board::computeHashKey() const {
+    uint64_t key = stateHashKey();
+    for(int color=0; color<2; ++color) {
+        for(int type=0; type<6; ++type) {
+            Bitboard b = pieces[color][type];
+            while(b)
+                key ^= zobristPiece(color, type, popLowestSquare(b));
+        }
+    }
+    return key;
 }
 
 
@@ -57,7 +209,7 @@ void Board::printBoard() const {
         --line;
         for (int x = 0; x < 8; ++x) {
             // Print all the pieces' representations for each line
-            cout << board[y][x].getSymbol() << " ";
+            cout << getPiece(y, x).getSymbol() << " ";
         }
         cout << endl;
     }
@@ -65,12 +217,14 @@ void Board::printBoard() const {
 }
 
 
-int Board::inputMove(string &input, int &old_row, int &old_col, int &new_row, int &new_col, const int& status) const {
+int Board::inputMove(string &input, int &old_row, int &old_col, int &new_row, int &new_col, const int& status,
+                     PieceType &promotion) const {
     /* Returns 0 if invalid input
-     * Returns 1 if valid Chess notation input
+     * Returns 1 if valid Chess notation input (a fifth letter like e7e8n picks the piece of a pawn promotion)
      * Returns 2 if the user wants a move suggestion (if input is "suggest")
      * Returns 3 if user wants to save the current board to file (input is "save")
      * Returns 4 if user wants to load a game from file (input is "load")
+     * Returns 5 if user wants to take back the last move (input is "undo")
      * Returns -1 if the user want to exit the game (if input is "exit") */
 
     // Lowercase all the letters in the input
@@ -85,14 +239,23 @@ int Board::inputMove(string &input, int &old_row, int &old_col, int &new_row, in
         return 3;
     else if(input == "load")
         return 4;
+    else if(input == "undo")
+        return 5;
     else if(input == "exit")
         return -1;
 
     // Then the input should be a move,
     // Check if the input is valid and if so, turn the string input into integer represented input accordingly
 
-    // Check the length of the input
-    if(input.length() != 4) {
+    // Check the length of the input, a fifth letter can only be a promotion piece
+    promotion = PieceType::Queen;
+    if(input.length() == 5) {
+        if(input[4] == 'q') promotion = PieceType::Queen;
+        else if(input[4] == 'r') promotion = PieceType::Rook;
+        else if(input[4] == 'b') promotion = PieceType::Bishop;
+        else if(input[4] == 'n') promotion = PieceType::Knight;
+        else return 0;
+    } else if(input.length() != 4) {
         return 0;
     }
 
@@ -128,7 +291,7 @@ int Board::inputMove(string &input, int &old_row, int &old_col, int &new_row, in
     }
 
     // Check if the player is trying to move opponent's piece
-    int pieceToBeMovedColor = board[old_row][old_col].getColor();
+    int pieceToBeMovedColor = getPiece(old_row, old_col).getColor();
     if(status != pieceToBeMovedColor) {
         return 0;
     }
@@ -138,40 +301,343 @@ int Board::inputMove(string &input, int &old_row, int &old_col, int &new_row, in
 }
 
 
-bool Board::movePiece(int old_row, int old_col, int new_row, int new_col) {
+bool Board::movePiece(int old_row, int old_col, int new_row, int new_col, PieceType promotion) {
     // Check if the move is legal to do as a Chess move
     bool legal = isLegalMove(old_row, old_col, new_row, new_col);
 
     if(legal) {
-        // Save the non-updated version of the board to be able to revert the move in case it's needed for other functions
-        previousBoard = board;
+        Move move = { static_cast<uint8_t>(toSquare(old_row, old_col)), static_cast<uint8_t>(toSquare(new_row, new_col)),
+                      PieceType::Empty };
+
+        // A pawn reaching the last row is promoted
+        if(getPiece(old_row, old_col).getType() == PieceType::Pawn && (new_row == 0 || new_row == 7))
+            move.promotion = promotion;
 
-        // Move the piece to new slot
+        // A move that leaves the King under attack is not legal either
+        if(!isLegal(move))
+            return false;
 
-        // Assign the old slot's features to the new one
-        board[new_row][new_col] = board[old_row][old_col];
-        // Change the has moved value of that piece
-        board[new_row][new_col].setMoved(1);
-        // Set the older location to be an empty slot
-        board[old_row][old_col].makeEmpty();
+        makeMove(move);
+        return true;
     } else {
         return false;
     }
-    return true;
 }
 
+void Board::makeMove(const Move &move) {
+    int from = move.from;
+    int to = move.to;
+    Piece piece = getPiece(rowOf(from), colOf(from));
+
+    // Save only what the move changes to be able to revert the move in case it's needed for other functions
+    history.push_back(UndoInfo());
+    UndoInfo &undo = history.back();
+    undo.move = move;
+    undo.captured = getPiece(rowOf(to), colOf(to)).getType();
+    undo.enPassantSquare = enPassantSquare;
+    undo.movedPieces = movedPieces;
+    undo.hashKey = hashKey;
+    undo.halfmoveClock = halfmoveClock;
+
+    // The side to move, castling and en passant part of the key is taken out here and the new one is added at the end,
+    // placePiece and removePiece update the pieces' part
+    hashKey ^= stateHashKey();
+
+    // Find every square this move changes before changing anything, the attack maps are updated around them
+    Bitboard changed = squareBit(from) | squareBit(to);
+    int capturedSquare = to;
+    int rookFrom = -1, rookTo = -1;
+
+    if(piece.getType() == PieceType::Pawn && to == enPassantSquare && colOf(from) != colOf(to)) {
+        // En passant: the pawn moves diagonally to the empty skipped square, the captured pawn stands next to the old slot
+        capturedSquare = toSquare(rowOf(from), colOf(to));
+        undo.captured = PieceType::Pawn;
+        changed |= squareBit(capturedSquare);
+    } else if(piece.getType() == PieceType::King && abs(colOf(to) - colOf(from)) == 2) {
+        // Castling: the Rook jumps over the King to the square next to it
+        bool kingSide = colOf(to) > colOf(from);
+        rookFrom = kingSide ? from + 3 : from - 4;
+        rookTo = kingSide ? from + 1 : from - 1;
+        changed |= squareBit(rookFrom) | squareBit(rookTo);
+    }
+
+    Bitboard stillAttacking = removeAttacksThrough(changed);
+
+    if(capturedSquare != to)
+        removePiece(capturedSquare);
+
+    if(rookFrom >= 0) {
+        Piece rook = getPiece(rowOf(rookFrom), colOf(rookFrom));
+        rook.setMoved(1);
+        removePiece(rookFrom);
+        placePiece(rookTo, rook);
+    }
+
+    // Only a pawn's two squares move allows an en passant capture on the next move
+    if(piece.getType() == PieceType::Pawn && abs(to - from) == 16)
+        enPassantSquare = (from + to) / 2;
+    else
+        enPassantSquare = -1;
+
+    // Captures and pawn moves start the fifty-move count again (a promotion is a pawn move, so the type is looked at
+    // before the pawn becomes the new piece), a full move ends with black's move
+    if(piece.getType() == PieceType::Pawn || undo.captured != PieceType::Empty)
+        halfmoveClock = 0;
+    else
+        ++halfmoveClock;
+
+    PieceType promotion = move.promotion;
+    if(promotion != PieceType::Empty)
+        piece.setType(promotion);
+    if(piece.getColor() == 1)
+        ++fullmoveNumber;
+
+    // Now it is the other player's turn
+    sideToMove = piece.getColor() == 0 ? 1 : 0;
+
+    // Change the has moved value of that piece
+    piece.setMoved(1);
+
+    // Remove the captured piece (if any) and the older location, then put the piece on the new slot
+    removePiece(to);
+    removePiece(from);
+    placePiece(to, piece);
+
+    hashKey ^= stateHashKey();
+
+    addAttacksThrough(changed, stillAttacking);
+}
+
+void Board::unmakeMove() {
+    const UndoInfo undo = history.back();
+    history.pop_back();
+    int from = undo.move.from;
+    int to = undo.move.to;
+    Piece piece = getPiece(rowOf(to), colOf(to));
+    int opponent = piece.getColor() == 0 ? 1 : 0;
+
+    // A promoted piece goes back as a pawn
+    if(undo.move.promotion != PieceType::Empty)
+        piece.setType(static_cast<int>(PieceType::Pawn));
+
+    // Find the same squares makeMove changed
+    Bitboard changed = squareBit(from) | squareBit(to);
+    int capturedSquare = to;
+    int rookFrom = -1, rookTo = -1;
+
+    if(piece.getType() == PieceType::Pawn && to == undo.enPassantSquare && colOf(from) != colOf(to)) {
+        // The pawn captured en passant was next to the old slot, not on the new one
+        capturedSquare = toSquare(rowOf(from), colOf(to));
+        changed |= squareBit(capturedSquare);
+    } else if(piece.getType() == PieceType::King && abs(colOf(to) - colOf(from)) == 2) {
+        // Castling: the Rook goes back to its corner
+        bool kingSide = colOf(to) > colOf(from);
+        rookFrom = kingSide ? from + 3 : from - 4;
+        rookTo = kingSide ? from + 1 : from - 1;
+        changed |= squareBit(rookFrom) | squareBit(rookTo);
+    }
+
+    Bitboard stillAttacking = removeAttacksThrough(changed);
+
+    removePiece(to);
+    placePiece(from, piece);
+
+    if(undo.captured != PieceType::Empty)
+        placePiece(capturedSquare, Piece(undo.captured, opponent));
+
+    if(rookFrom >= 0) {
+        Piece rook = getPiece(rowOf(rookTo), colOf(rookTo));
+        removePiece(rookTo);
+        placePiece(rookFrom, rook);
+    }
+
+    // Moved flags of every piece (including the captured one) and the en passant square are restored as they were.
+    // Only the pieces on the changed squares can have a different flag in their code.
+    movedPieces = undo.movedPieces;
+    Bitboard b = changed & occupancy;
+    while(b) {
+        int square = popLowestSquare(b);
+        Piece restored = Piece::fromCode(mailbox[square]);
+        restored.setMoved((movedPieces & squareBit(square)) ? 1 : 0);
+        mailbox[square] = restored.getCode();
+    }
+    enPassantSquare = undo.enPassantSquare;
+    sideToMove = piece.getColor();
+    halfmoveClock = undo.halfmoveClock;
+    if(sideToMove == 1)
+        --fullmoveNumber;
+    // Restoring the key is cheaper than updating it back
+    hashKey = undo.hashKey;
+
+    addAttacksThrough(changed, stillAttacking);
+}
+
+Bitboard Board::pieceAttacks(int square) const {
+    Piece piece = getPiece(rowOf(square), colOf(square));
+
+    switch(piece.getType()) {
+        case PieceType::Pawn: return pawnAttacks(piece.getColor(), square);
+        case PieceType::Knight: return knightAttacks(square);
+        case PieceType::Bishop: return bishopAttacks(square, occupancy);
+        case PieceType::Rook: return rookAttacks(square, occupancy);
+        case PieceType::Queen: return bishopAttacks(square, occupancy) | rookAttacks(square, occupancy);
+        case PieceType::King: return kingAttacks(square);
+        default: return 0;
+    }
+}
+
+void Board::updateAttackCounts(int square, int change) {
+    int color = (colorOccupancy[0] & squareBit(square)) ? 0 : 1;
+    Bitboard attacks = pieceAttacks(square);
+
+    if(change > 0) {
+        attackMap[color] |= attacks;
+        while(attacks)
+            ++attackCount[color][popLowestSquare(attacks)];
+    } else {
+        while(attacks) {
+            int target = popLowestSquare(attacks);
+            // The square is no longer attacked by this color once its last attacker is gone
+            if(--attackCount[color][target] == 0)
+                attackMap[color] &= ~squareBit(target);
+        }
+    }
+}
+
+Bitboard Board::removeAttacksThrough(Bitboard changed) {
+    // Pieces on the changed squares will move or disappear, and sliding pieces whose rays reach one of the changed squares
+    // may see further or shorter after the move. Every other piece attacks the same squares before and after the move.
+    Bitboard diagonalSliders = pieces[0][static_cast<int>(PieceType::Bishop)] | pieces[1][static_cast<int>(PieceType::Bishop)]
+                               | pieces[0][static_cast<int>(PieceType::Queen)] | pieces[1][static_cast<int>(PieceType::Queen)];
+    Bitboard straightSliders = pieces[0][static_cast<int>(PieceType::Rook)] | pieces[1][static_cast<int>(PieceType::Rook)]
+                               | pieces[0][static_cast<int>(PieceType::Queen)] | pieces[1][static_cast<int>(PieceType::Queen)];
+
+    Bitboard sliders = 0;
+    Bitboard b = changed;
+    while(b) {
+        int square = popLowestSquare(b);
+        sliders |= (bishopAttacks(square, occupancy) & diagonalSliders) | (rookAttacks(square, occupancy) & straightSliders);
+    }
+
+    Bitboard affected = (changed & occupancy) | sliders;
+    b = affected;
+    while(b)
+        updateAttackCounts(popLowestSquare(b), -1);
+
+    // Sliders that don't stand on a changed square stay where they are, their attacks are added back after the move
+    return affected & ~changed;
+}
+
+void Board::addAttacksThrough(Bitboard changed, Bitboard stillAttacking) {
+    Bitboard b = (changed & occupancy) | stillAttacking;
+    while(b)
+        updateAttackCounts(popLowestSquare(b), 1);
+}
+
+void Board::computeAttackMaps() {
+    for(int color=0; color<2; ++color) {
+        attackMap[color] = 0;
+        for(int square=0; square<64; ++square)
+            attackCount[color][square] = 0;
+    }
 
-void Board::revertMove() {
-    // Assigns the previous board to the current board which makes the last move revert
-    board = previousBoard;
+    for(int color=0; color<2; ++color) {
+        for(int i=0; i<pieceCount[color]; ++i)
+            updateAttackCounts(pieceList[color][i], 1);
+    }
+}
+
+
+bool Board::parseMove(const string &notation, Move &move) {
+    // Check and annotation marks don't change the move
+    string text = notation;
+    while(!text.empty() && (text.back() == '+' || text.back() == '#' || text.back() == '!' || text.back() == '?'))
+        text.pop_back();
+    if(text.empty())
+        return false;
+
+    // What the algebraic notation asks for, -1 where it doesn't say
+    PieceType type = PieceType::Pawn;
+    PieceType promotion = PieceType::Empty;
+    int to = -1, fromRow = -1, fromCol = -1;
+    bool castling = text == "O-O" || text == "0-0" || text == "O-O-O" || text == "0-0-0";
+
+    if(castling) {
+        int row = sideToMove == 0 ? 7 : 0;
+        type = PieceType::King;
+        fromRow = row;
+        fromCol = 4;
+        to = toSquare(row, text.length() == 3 ? 6 : 2);
+    } else {
+        string san = text;
+        // Promotion at the end: e8=Q or e8Q
+        if(san.length() > 2 && isupper(static_cast<unsigned char>(san.back()))
+           && (san[san.length() - 2] == '=' || isdigit(static_cast<unsigned char>(san[san.length() - 2])))) {
+            promotion = pieceFromSymbol(san.back()).getType();
+            san.pop_back();
+            if(san.back() == '=')
+                san.pop_back();
+        }
+        if(!san.empty() && isupper(static_cast<unsigned char>(san[0]))) {
+            type = pieceFromSymbol(san[0]).getType();
+            san.erase(0, 1);
+        }
+        size_t length = san.length();
+        if(length >= 2 && san[length - 2] >= 'a' && san[length - 2] <= 'h' && san.back() >= '1' && san.back() <= '8') {
+            to = toSquare('8' - san.back(), san[length - 2] - 'a');
+            san.erase(san.length() - 2);
+        }
+        // Whatever is left tells the file and/or rank the piece comes from
+        for(char c : san) {
+            if(c >= 'a' && c <= 'h')
+                fromCol = c - 'a';
+            else if(c >= '1' && c <= '8')
+                fromRow = '8' - c;
+        }
+    }
+
+    MoveList moveList;
+    generateLegalMoves(sideToMove, moveList);
+
+    int found = 0;
+    for(int i=0; i<moveList.count; ++i) {
+        const Move &candidate = moveList.moves[i];
+        bool matches;
+        if(moveToString(candidate) == notation) {
+            matches = true;
+        } else {
+            // A promotion without a piece is taken as a Queen
+            PieceType movedType = getPiece(rowOf(candidate.from), colOf(candidate.from)).getType();
+            matches = type != PieceType::Empty && to == candidate.to && movedType == type
+                      && (fromRow < 0 || fromRow == rowOf(candidate.from)) && (fromCol < 0 || fromCol == colOf(candidate.from))
+                      && (candidate.promotion == promotion
+                          || (promotion == PieceType::Empty && candidate.promotion == PieceType::Queen));
+        }
+        if(matches) {
+            move = candidate;
+            ++found;
+        }
+    }
+    return found == 1;
+}
+
+bool Board::revertMove() {
+    // Takes back the last move on the undo stack, nothing to revert if no move was made
+    if(history.empty())
+        return false;
+
+    unmakeMove();
+    return true;
 }
 
 
 bool Board::isLegalMove(int old_row, int old_col, int new_row, int new_col) const {
-    int color = board[old_row][old_col].getColor();
+    Piece piece = getPiece(old_row, old_col);
+    Piece target = getPiece(new_row, new_col);
+    int color = piece.getColor();
 
     // Check for the possible moves of a piece
-    switch (board[old_row][old_col].getType()) {
+    switch (piece.getType()) {
         case PieceType::Empty: {
             // Can't move an empty slot
             return false;
@@ -180,13 +646,13 @@ bool Board::isLegalMove(int old_row, int old_col, int new_row, int new_col) cons
             // Pawn can move 1 forward (or 2 forward if it has not been moved before) if it's path is clear.
             // It can move diagonally 1-1 only to capture enemy piece.
             // (isPathEmpty function is not used on purpose for pawns since their movement is different)
-            PieceType new_slot_type = board[new_row][new_col].getType();
+            PieceType new_slot_type = target.getType();
 
             if(new_slot_type == PieceType::Empty && old_col == new_col) {
-                // Can move 2 squares forward if it has not been moved before
+                // Can move 2 squares forward from its starting row
                 if(new_row == old_row + (color == 0 ? -2 : 2)) {
-                    if(board[old_row][old_col].gethasMoved() == 0
-                       && board[old_row + (color == 0 ? -1 : 1)][old_col].getType() == PieceType::Empty) {
+                    if(old_row == (color == 0 ? 6 : 1)
+                       && !(occupancy & squareBit(toSquare(old_row + (color == 0 ? -1 : 1), old_col)))) {
                         return true;
                     }
                     // Pawn can move 1 square forward in normal cases
@@ -195,7 +661,14 @@ bool Board::isLegalMove(int old_row, int old_col, int new_row, int new_col) cons
                 }
                 // Pawn can capture diagonally
             } else if((new_slot_type != PieceType::Empty)
-                      && board[new_row][new_col].getColor() == (color == 0 ? 1 : 0)
+                      && target.getColor() == (color == 0 ? 1 : 0)
+                      && (new_col == old_col + 1 || new_col == old_col - 1)
+                      && (new_row == old_row + (color == 0 ? -1 : 1))) {
+                return true;
+                // Pawn can capture en passant, right after the opponent pawn skipped the square with a two squares move
+            } else if(new_slot_type == PieceType::Empty
+                      && toSquare(new_row, new_col) == enPassantSquare
+                      && new_row == (color == 0 ? 2 : 5)
                       && (new_col == old_col + 1 || new_col == old_col - 1)
                       && (new_row == old_row + (color == 0 ? -1 : 1))) {
                 return true;
@@ -204,50 +677,33 @@ bool Board::isLegalMove(int old_row, int old_col, int new_row, int new_col) cons
             return false;
         }
         case PieceType::Rook: {
-            // Can move straight, only row or col value can change with a single move
-            if(!isPathEmpty(old_row, old_col, new_row, new_col))
-                return false;
-            int rowChange = old_row - new_row;
-            int colChange = old_col - new_col;
-            if((rowChange == 0 && colChange != 0) || (rowChange != 0 && colChange == 0))
-                return true;
-
-            return false;
+            // Can move straight until the first piece on the way, and take it if it is an opponent piece.
+            // The attack table already stops the rays at the first piece, so one lookup answers it.
+            return (rookAttacks(toSquare(old_row, old_col), occupancy) & ~colorOccupancy[color]
+                    & squareBit(toSquare(new_row, new_col))) != 0;
         }
         case PieceType::Bishop: {
-            // Can move diagonally, difference of row and col must be equal
-            if(!isPathEmpty(old_row, old_col, new_row, new_col))
-                return false;
-            int rowChange = abs(old_row - new_row);
-            int colChange = abs(old_col - new_col);
-            if(rowChange == colChange && rowChange != 0 && colChange != 0)
-                return true;
-
-            return false;
+            // Can move diagonally, the same way as the Rook above
+            return (bishopAttacks(toSquare(old_row, old_col), occupancy) & ~colorOccupancy[color]
+                    & squareBit(toSquare(new_row, new_col))) != 0;
         }
         case PieceType::Queen: {
             // Queen can move like Bishop and Rook combined
-            if(!isPathEmpty(old_row, old_col, new_row, new_col))
-                return false;
-            int rowChange = abs(old_row - new_row);
-            int colChange = abs(old_col - new_col);
-            if( (rowChange == colChange && rowChange != 0 && colChange != 0) // Can move like Bishop
-                || ((rowChange == 0 && colChange != 0) || (rowChange != 0 && colChange == 0)))
-                return true;
-
-            return false;
+            int from = toSquare(old_row, old_col);
+            Bitboard attacks = bishopAttacks(from, occupancy) | rookAttacks(from, occupancy);
+            return (attacks & ~colorOccupancy[color] & squareBit(toSquare(new_row, new_col))) != 0;
         }
         case PieceType::King: {
-            if(!isPathEmpty(old_row, old_col, new_row, new_col))
-                return false;
             int rowChange = abs(old_row - new_row);
             int colChange = abs(old_col - new_col);
 
-            if((rowChange == 1 && colChange == 1) || (rowChange == 1 && colChange == 0)
-               || (rowChange == 0 && colChange == 1) )
-                return true;
+            // Castling moves the King 2 squares towards one of its Rooks
+            if(rowChange == 0 && colChange == 2 && old_col == 4 && old_row == (color == 0 ? 7 : 0))
+                return canCastle(color, new_col > old_col);
 
-            return false;
+            // One square in any direction
+            return (kingAttacks(toSquare(old_row, old_col)) & ~colorOccupancy[color]
+                    & squareBit(toSquare(new_row, new_col))) != 0;
         }
         case PieceType::Knight: {
             // Can move like an L shape
@@ -255,9 +711,9 @@ bool Board::isLegalMove(int old_row, int old_col, int new_row, int new_col) cons
             int rowChange = abs(old_row - new_row);
             int colChange = abs(old_col - new_col);
 
-            PieceType new_slot_type = board[new_row][new_col].getType();
-            int old_slot_color = board[old_row][old_col].getColor();
-            int new_slot_color = board[new_row][new_col].getColor();
+            PieceType new_slot_type = target.getType();
+            int old_slot_color = color;
+            int new_slot_color = target.getColor();
 
             if(((rowChange == 2 && colChange == 1) || (rowChange == 1 && colChange == 2))
                && ((new_slot_type == PieceType::Empty) || (new_slot_color != old_slot_color)) )
@@ -272,154 +728,454 @@ bool Board::isLegalMove(int old_row, int old_col, int new_row, int new_col) cons
 }
 
 bool Board::isPathEmpty(int old_row, int old_col, int new_row, int new_col) const {
-    int oldColor = board[old_row][old_col].getColor();
-    int newColor = board[new_row][new_col].getColor();
-
-    // Check the path till the new slot
-    int rowDifference = old_row - new_row;
-    int colDifference = old_col - new_col;
-    int rowChangeDirection = 0;
-    int colChangeDirection = 0;
-
-    if(rowDifference > 0) rowChangeDirection = -1;
-    else if(rowDifference < 0) rowChangeDirection = 1;
-
-    if(colDifference > 0) colChangeDirection = -1;
-    else if(colDifference < 0) colChangeDirection = 1;
-
-    if(rowDifference != 0 && colDifference != 0) {
-        while(old_row != new_row && old_col != new_col) {
-            // If only row or col is changed, then row/col change direction value will be 0, only the one that changed will change.
-            old_row += rowChangeDirection;
-            old_col += colChangeDirection;
-            if(board[old_row][old_col].getType() != PieceType::Empty) {
-                if(old_row == new_row && old_col == new_col && oldColor != newColor)
-                    return true;
-                return false;
+    int from = toSquare(old_row, old_col);
+    int to = toSquare(new_row, new_col);
+
+    // The new slot can't have a piece of the same color
+    if(occupancy & squareBit(to)) {
+        int oldColor = (colorOccupancy[0] & squareBit(from)) ? 0 : 1;
+        if(colorOccupancy[oldColor] & squareBit(to))
+            return false;
+    }
+
+    // Every square between the two slots has to be empty (there are none if they are not on the same row, col or diagonal)
+    return !(betweenSquares(from, to) & occupancy);
+}
+
+Bitboard Board::attackersOf(int square, int color) const {
+    return attackersOf(square, color, occupancy);
+}
+
+Bitboard Board::attackersOf(int square, int color, Bitboard occupied) const {
+    const Bitboard *own = pieces[color];
+    Bitboard bishopsQueens = own[static_cast<int>(PieceType::Bishop)] | own[static_cast<int>(PieceType::Queen)];
+    Bitboard rooksQueens = own[static_cast<int>(PieceType::Rook)] | own[static_cast<int>(PieceType::Queen)];
+
+    // A pawn of this color attacks the square if it stands where an opponent pawn on the square would attack
+    return (pawnAttacks(color == 0 ? 1 : 0, square) & own[static_cast<int>(PieceType::Pawn)])
+           | (knightAttacks(square) & own[static_cast<int>(PieceType::Knight)])
+           | (kingAttacks(square) & own[static_cast<int>(PieceType::King)])
+           | (bishopAttacks(square, occupied) & bishopsQueens)
+           | (rookAttacks(square, occupied) & rooksQueens);
+}
+
+Bitboard Board::attackedSquares(int color) const {
+    return attackMap[color];
+}
+
+int Board::attackerCount(int square, int color) const {
+    return attackCount[color][square];
+}
+
+bool Board::canCastle(int color, bool kingSide) const {
+    int opponent = color == 0 ? 1 : 0;
+    int kingStart = toSquare(color == 0 ? 7 : 0, 4);
+    int rookSquare = kingSide ? kingStart + 3 : kingStart - 4;
+
+    // King and Rook must be on their starting squares and must have not been moved before
+    if(kingSquare[color] != kingStart
+       || !(pieces[color][static_cast<int>(PieceType::Rook)] & squareBit(rookSquare))
+       || (movedPieces & (squareBit(kingStart) | squareBit(rookSquare))))
+        return false;
+
+    // All the squares between the King and the Rook must be empty
+    int step = kingSide ? 1 : -1;
+    for(int square = kingStart + step; square != rookSquare; square += step) {
+        if(occupancy & squareBit(square))
+            return false;
+    }
+
+    // King can't castle out of check, through an attacked square or into check
+    for(int i=0; i<3; ++i) {
+        if(attackMap[opponent] & squareBit(kingStart + i * step))
+            return false;
+    }
+
+    return true;
+}
+
+void Board::generateMoves(int color, MoveList &moveList, MoveGenType type) const {
+    generateMoveList(color, moveList, type, false);
+}
+
+void Board::generateLegalMoves(int color, MoveList &moveList, MoveGenType type) const {
+    generateMoveList(color, moveList, type, true);
+}
+
+void Board::generateMoveList(int color, MoveList &moveList, MoveGenType type, bool legalOnly) const {
+    moveList.count = 0;
+
+    int opponent = color == 0 ? 1 : 0;
+    const Bitboard *own = pieces[color];
+    Bitboard b;
+
+    // Empty squares or opponent pieces, only one of them for captures or quiet moves
+    Bitboard targets = ~colorOccupancy[color];
+    if(type == MoveGenType::Captures)
+        targets = colorOccupancy[opponent];
+    else if(type == MoveGenType::Quiets)
+        targets = ~occupancy;
+
+    // For the legal moves: where the pieces other than the King can go (see findChecksAndPins)
+    bool legal = legalOnly && kingSquare[color] >= 0;
+    Bitboard checkers = 0;
+    Bitboard checkMask = ~0ULL;
+    Bitboard pinned = 0;
+    Bitboard pinRays[64];
+    if(legal)
+        findChecksAndPins(color, checkers, checkMask, pinned, pinRays);
+
+    // Pawns move one square forward (white towards row 0, black towards row 7), two squares from their starting row,
+    // capture diagonally (also en passant) and are promoted on the last row.
+    int forward = color == 0 ? -8 : 8;
+    int startRow = color == 0 ? 6 : 1;
+    int lastRow = color == 0 ? 0 : 7;
+    Bitboard pawnTargets = colorOccupancy[opponent];
+    Bitboard enPassantTarget = 0;
+    if(enPassantSquare >= 0 && rowOf(enPassantSquare) == (color == 0 ? 2 : 5))
+        enPassantTarget = squareBit(enPassantSquare);
+    pawnTargets |= enPassantTarget;
+
+    b = own[static_cast<int>(PieceType::Pawn)];
+    while(b) {
+        int from = popLowestSquare(b);
+        if(rowOf(from) == lastRow)
+            continue;
+
+        Bitboard pawnMoves = pawnAttacks(color, from) & pawnTargets;
+        int to = from + forward;
+        if(!(occupancy & squareBit(to))) {
+            pawnMoves |= squareBit(to);
+            if(rowOf(from) == startRow && !(occupancy & squareBit(to + forward)))
+                pawnMoves |= squareBit(to + forward);
+        }
+
+        // Captures and promotions change the material, the other pawn moves are quiet
+        if(type == MoveGenType::Captures)
+            pawnMoves &= pawnTargets | rowMask(lastRow);
+        else if(type == MoveGenType::Quiets)
+            pawnMoves &= ~pawnTargets & ~rowMask(lastRow);
+
+        if(legal) {
+            // En passant takes the pawn beside the square it moves to, so it is checked on its own
+            Bitboard enPassant = pawnMoves & enPassantTarget;
+            pawnMoves &= checkMask & ~enPassantTarget;
+            if(pinned & squareBit(from))
+                pawnMoves &= pinRays[from];
+            if(enPassant && isLegalEnPassant(from, color))
+                pawnMoves |= enPassant;
+        }
+
+        while(pawnMoves) {
+            to = popLowestSquare(pawnMoves);
+            if(rowOf(to) == lastRow) {
+                moveList.add(from, to, PieceType::Queen);
+                moveList.add(from, to, PieceType::Rook);
+                moveList.add(from, to, PieceType::Bishop);
+                moveList.add(from, to, PieceType::Knight);
+            } else {
+                moveList.add(from, to);
             }
         }
-    } else if(rowDifference != 0 /*&& colDifference == 0*/) {
-        while(old_row != new_row) {
-            old_row += rowChangeDirection;
-            if(board[old_row][old_col].getType() != PieceType::Empty) {
-                if(old_row == new_row && oldColor != newColor)
-                    return true;
-                return false;
+    }
+
+    // Other pieces move to every square they attack, unless it has a piece of the same color
+    for(int type=0; type<6; ++type) {
+        PieceType pieceType = static_cast<PieceType>(type);
+        if(pieceType == PieceType::Pawn)
+            continue;
+
+        b = own[type];
+        while(b) {
+            int from = popLowestSquare(b);
+            Bitboard pieceMoves;
+            switch(pieceType) {
+                case PieceType::Knight: pieceMoves = knightAttacks(from); break;
+                case PieceType::Bishop: pieceMoves = bishopAttacks(from, occupancy); break;
+                case PieceType::Rook: pieceMoves = rookAttacks(from, occupancy); break;
+                case PieceType::Queen: pieceMoves = bishopAttacks(from, occupancy) | rookAttacks(from, occupancy); break;
+                default: pieceMoves = kingAttacks(from); break;
             }
+
+            pieceMoves &= targets;
+            if(legal && pieceType == PieceType::King) {
+                // The King can't go to an attacked square. When a slider checks it, the squares behind the King on the
+                // slider's line are attacked too once the King is gone, the attack maps don't show those.
+                pieceMoves &= ~attackMap[opponent];
+                if(checkers) {
+                    Bitboard candidates = pieceMoves;
+                    Bitboard withoutKing = occupancy ^ squareBit(from);
+                    while(candidates) {
+                        int to = popLowestSquare(candidates);
+                        if(attackersOf(to, opponent, withoutKing))
+                            pieceMoves &= ~squareBit(to);
+                    }
+                }
+            } else if(legal) {
+                pieceMoves &= checkMask;
+                if(pinned & squareBit(from))
+                    pieceMoves &= pinRays[from];
+            }
+
+            while(pieceMoves)
+                moveList.add(from, popLowestSquare(pieceMoves));
+        }
+    }
+
+    // Castling is a King move of two squares (canCastle checks the King is not in check and passes no attacked square)
+    if(type == MoveGenType::Captures)
+        return;
+    if(canCastle(color, true))
+        moveList.add(kingSquare[color], kingSquare[color] + 2);
+    if(canCastle(color, false))
+        moveList.add(kingSquare[color], kingSquare[color] - 2);
+}
+
+void Board::findChecksAndPins(int color, Bitboard &checkers, Bitboard &checkMask, Bitboard &pinned,
+                              Bitboard pinRays[64]) const {
+    int opponent = color == 0 ? 1 : 0;
+    int king = kingSquare[color];
+
+    checkers = attackersOf(king, opponent);
+    checkMask = ~0ULL;
+    if(popCount(checkers) > 1)
+        checkMask = 0;
+    else if(checkers)
+        checkMask = betweenSquares(king, lowestSquare(checkers)) | checkers;
+
+    // Opponent sliders that would attack the King if there were no pieces in between
+    const Bitboard *theirs = pieces[opponent];
+    Bitboard snipers = (rookAttacks(king, 0) & (theirs[static_cast<int>(PieceType::Rook)]
+                                                | theirs[static_cast<int>(PieceType::Queen)]))
+                       | (bishopAttacks(king, 0) & (theirs[static_cast<int>(PieceType::Bishop)]
+                                                    | theirs[static_cast<int>(PieceType::Queen)]));
+    pinned = 0;
+    while(snipers) {
+        int sniper = popLowestSquare(snipers);
+        Bitboard blockers = betweenSquares(king, sniper) & occupancy;
+        if(popCount(blockers) == 1 && (blockers & colorOccupancy[color])) {
+            pinned |= blockers;
+            pinRays[lowestSquare(blockers)] = betweenSquares(king, sniper) | squareBit(sniper);
         }
-    } else if(/*rowDifference == 0 &&*/ colDifference != 0) {
-        while(old_col != new_col) {
-            old_col += colChangeDirection;
-            if(board[old_row][old_col].getType() != PieceType::Empty) {
-                if(old_col == new_col && oldColor != newColor)
+    }
+}
+
+bool Board::hasLegalMove(int color) const {
+    int opponent = color == 0 ? 1 : 0;
+    int king = kingSquare[color];
+    if(king < 0)
+        return false;
+
+    Bitboard checkers, checkMask, pinned;
+    Bitboard pinRays[64];
+    findChecksAndPins(color, checkers, checkMask, pinned, pinRays);
+
+    // 1. The King steps to a square that is not attacked (when a slider checks it, the square behind the King on the
+    // slider's line is attacked once the King is gone, the attack maps don't show it)
+    Bitboard escapes = kingAttacks(king) & ~colorOccupancy[color] & ~attackMap[opponent];
+    if(escapes && !checkers)
+        return true;
+    Bitboard withoutKing = occupancy ^ squareBit(king);
+    while(escapes) {
+        if(!attackersOf(popLowestSquare(escapes), opponent, withoutKing))
+            return true;
+    }
+
+    // In double check only the King can move
+    if(checkMask == 0)
+        return false;
+
+    // 2. In check: another piece takes the checking piece, then 3. one steps in between. Not in check: any move of
+    // another piece (castling needs a King move to be possible, which was looked at above).
+    Bitboard groups[2] = { checkers ? checkers : ~colorOccupancy[color], checkers ? checkMask & ~checkers : 0 };
+    int forward = color == 0 ? -8 : 8;
+    int startRow = color == 0 ? 6 : 1;
+    Bitboard enPassantTarget = 0;
+    if(enPassantSquare >= 0 && rowOf(enPassantSquare) == (color == 0 ? 2 : 5))
+        enPassantTarget = squareBit(enPassantSquare);
+
+    for(Bitboard group : groups) {
+        if(!group)
+            continue;
+
+        Bitboard b = colorOccupancy[color] & ~squareBit(king);
+        while(b) {
+            int from = popLowestSquare(b);
+            PieceType type = Piece::fromCode(mailbox[from]).getType();
+            Bitboard moves;
+            if(type == PieceType::Pawn) {
+                moves = pawnAttacks(color, from) & colorOccupancy[opponent];
+                int to = from + forward;
+                if(!(occupancy & squareBit(to))) {
+                    moves |= squareBit(to);
+                    if(rowOf(from) == startRow && !(occupancy & squareBit(to + forward)))
+                        moves |= squareBit(to + forward);
+                }
+                if((pawnAttacks(color, from) & enPassantTarget) && isLegalEnPassant(from, color))
                     return true;
-                return false;
+            } else {
+                moves = pieceAttacks(from);
             }
+
+            moves &= group;
+            if(pinned & squareBit(from))
+                moves &= pinRays[from];
+            if(moves)
+                return true;
         }
     }
+    return false;
+}
 
+GameStatus Board::gameStatus(int color) const {
+    if(hasLegalMove(color))
+        return GameStatus::Ongoing;
+    return (kingSquare[color] >= 0 && (attackMap[color == 0 ? 1 : 0] & squareBit(kingSquare[color])))
+           ? GameStatus::Checkmate : GameStatus::Stalemate;
+}
 
-    return true;
+bool Board::isLegalEnPassant(int from, int color) const {
+    int opponent = color == 0 ? 1 : 0;
+    int to = enPassantSquare;
+    int captured = to + (color == 0 ? 8 : -8);
+
+    // The position after the capture: the pawn moved and the captured pawn gone (it can't attack anymore either)
+    Bitboard occupied = (occupancy ^ squareBit(from) ^ squareBit(captured)) | squareBit(to);
+    return !(attackersOf(kingSquare[color], opponent, occupied) & ~squareBit(captured));
 }
 
+bool Board::isLegal(const Move &move) const {
+    int from = move.from;
+    int to = move.to;
+    int color = (colorOccupancy[0] & squareBit(from)) ? 0 : 1;
+    int opponent = color == 0 ? 1 : 0;
+    int king = kingSquare[color];
+    if(king < 0)
+        return true;
+
+    if(from == king) {
+        // Castling was checked by canCastle, the other King moves can't go to an attacked square (the King doesn't
+        // block the attacks on the squares behind it anymore)
+        if(rowOf(from) == rowOf(to) && abs(to - from) == 2)
+            return true;
+        return !attackersOf(to, opponent, occupancy ^ squareBit(from));
+    }
 
+    if(to == enPassantSquare && colOf(from) != colOf(to)
+       && (pieces[color][static_cast<int>(PieceType::Pawn)] & squareBit(from)))
+        return isLegalEnPassant(from, color);
 
-int Board::isKingSafe(int colorOfKing) {
-    /* Returns -2 if something is wrong (King not found)
-     * Returns  0 for CHECK - the King is not safe and there is at least one move to save it
-     * Returns  1 if the King is safe */
+    // After the move no piece may attack the King, except the one the move takes
+    Bitboard occupied = (occupancy ^ squareBit(from)) | squareBit(to);
+    return !(attackersOf(king, opponent, occupied) & ~squareBit(to));
+}
+
+bool Board::isPseudoLegal(const Move &move) const {
+    int color = sideToMove;
+    int opponent = color == 0 ? 1 : 0;
+    int from = move.from;
+    int to = move.to;
+    Bitboard toBit = squareBit(to);
 
+    // The side to move has to move its own piece, and can't take its own piece
+    if(from > 63 || to > 63 || !(colorOccupancy[color] & squareBit(from)) || (colorOccupancy[color] & toBit))
+        return false;
 
-    // Find the current location of the King with the specified color
-    int king_row = -1;
-    int king_col = -1;
+    PieceType type = getPiece(rowOf(from), colOf(from)).getType();
 
-    for(int i=0; i<8; ++i) {
-        for(int j=0; j<8; ++j) {
-            if(board[i][j].getType() == PieceType::King && board[i][j].getColor() == colorOfKing) {
-                king_row = i;
-                king_col = j;
-                break;
-            }
-        }
+    if(type == PieceType::Pawn) {
+        int forward = color == 0 ? -8 : 8;
+        int startRow = color == 0 ? 6 : 1;
+        bool lastRow = rowOf(to) == (color == 0 ? 0 : 7);
+
+        // A pawn reaching the last row has to be promoted to a Queen, Rook, Bishop or Knight, no other move promotes
+        if(lastRow != (move.promotion != PieceType::Empty)
+           || move.promotion == PieceType::Pawn || move.promotion == PieceType::King)
+            return false;
+
+        if(pawnAttacks(color, from) & toBit)
+            return (colorOccupancy[opponent] & toBit)
+                   || (to == enPassantSquare && rowOf(enPassantSquare) == (color == 0 ? 2 : 5));
+        if(to == from + forward)
+            return !(occupancy & toBit);
+        if(to == from + 2 * forward)
+            return rowOf(from) == startRow && !(occupancy & (squareBit(from + forward) | toBit));
+        return false;
     }
 
+    if(move.promotion != PieceType::Empty)
+        return false;
+
+    // Castling is the only King move of two squares
+    if(type == PieceType::King && rowOf(from) == rowOf(to) && abs(to - from) == 2)
+        return canCastle(color, to > from);
+
+    return (pieceAttacks(from) & toBit) != 0;
+}
+
+bool Board::isCapture(const Move &move) const {
+    if(occupancy & squareBit(move.to))
+        return true;
+
+    // En passant: a pawn moving diagonally to the empty skipped square
+    return move.to == enPassantSquare && colOf(move.from) != colOf(move.to)
+           && (pieces[sideToMove][static_cast<int>(PieceType::Pawn)] & squareBit(move.from));
+}
+
+
+int Board::isKingSafe(int colorOfKing) {
+    /* Returns -2 if something is wrong (King not found)
+     * Returns  0 for CHECK - the King is not safe and there is at least one move to save it
+     * Returns  1 if the King is safe */
+
     // Something is wrong, king not found
-    if(king_row == -1 || king_col == -1)
+    if(kingSquare[colorOfKing] < 0)
         return -2;
 
-    // Loop through all the pieces to see if any one has a legal move to the King
-    for(int i=0; i<8; ++i) {
-        for(int j=0; j<8; ++j) {
-            if(board[i][j].getColor() != colorOfKing && board[i][j].getType() != PieceType::Empty) {
-                if(isLegalMove(i,j,king_row,king_col)) {
-                    // There is a legal move to King, it is not safe.
-                    return 0;
-                }
-            }
-        }
+    // Check if any opponent piece attacks the King's square
+    if(attackMap[colorOfKing == 0 ? 1 : 0] & squareBit(kingSquare[colorOfKing])) {
+        // There is a legal move to King, it is not safe.
+        return 0;
     }
 
-
     // No legal moves to King, return safe.
     return 1;
 }
 
-int Board::isCheckmate(int colorOfKing) {
+int Board::isCheckmate(int colorOfKing, TranspositionTable *table) {
     /* Returns -2 if something is wrong (King not found)
      * Returns -1 for CHECKMATE - if King is NOT safe and has no moves
      * Returns  0 if the King is not safe
      * Returns  1 if the King is safe */
 
     // Make sure the King is not safe before checking if it's checkmate
-    if(isKingSafe(colorOfKing) == 0) {
-        int king_row = -1;
-        int king_col = -1;
-
-        // Find the current location of the King with the specified color
-        for(int i=0; i<8; ++i) {
-            for(int j=0; j<8; ++j) {
-                if(board[i][j].getType() == PieceType::King && board[i][j].getColor() == colorOfKing) {
-                    king_row = i;
-                    king_col = j;
-                    break;
-                }
-            }
-        }
+    int kingSafe = isKingSafe(colorOfKing);
+    if(kingSafe == 0) {
+        // Check if any piece has a move that blocks/stops the attack to the King (this includes the King escaping by
+        // itself), if anything at all is possible, it is not checkmate, only check.
+
+        // The table's entries are about the position with the King's color to move
+        bool useTable = table != nullptr && sideToMove == colorOfKing;
+        TTEntry entry;
+        bool found = useTable && table->probe(hashKey, entry);
+
+        // The search stores a checkmated position as an exact mate score
+        if(found && entry.bound == Bound::Exact && entry.score == -Search::MATE_SCORE)
+            return -1;
+
+        // One legal move is enough to save the King
+        if(hasLegalMove(colorOfKing))
+            return 0;
 
-        // Something is wrong, king not found
-        if(king_row == -1 || king_col == -1)
-            return -2;
-
-
-        // Check every pieces' every next possible move and see if any move can block/stop the attack to the King
-        // (this includes checking if King can escape by itself), if anything at all is possible, it is not checkmate, only check.
-
-        for(int i=0; i < 8; ++i) {
-            for (int j=0; j < 8; ++j) {
-                if(board[i][j].getType() != PieceType::Empty && board[i][j].getColor() == colorOfKing) {
-                    for(int k=0; k < 8; ++k) {
-                        for(int m=0; m < 8; ++m) {
-                            if(movePiece(i,j,k,m)) {
-                                if(isKingSafe(colorOfKing)) {
-                                    // King is safe with this move! Revert the move and return not checkmate, only check.
-                                    revertMove();
-
-                                    return 0;
-                                }
-                                // King is still not safe with this move, revert the move and continue the loop.
-                                revertMove();
-                            }
-                        }
-                    }
-                }
-            }
-        }
         // Checkmate, none of the pieces' moves can save the King.
+        if(useTable) {
+            Move noMove = { 0, 0, PieceType::Empty };
+            table->store(hashKey, Search::MAX_DEPTH, Bound::Exact, -Search::MATE_SCORE, noMove);
+        }
         return -1;
     } else {
-        // King is safe, it can not be checkmate.
-        return 1;
+        // King is safe (or not found), it can not be checkmate.
+        return kingSafe;
     }
 }
 
@@ -429,148 +1185,77 @@ bool Board::isPieceSafe(int row, int col, int color) const {
     /* Precondition: This function assumes the given row and col is NOT empty.
      * Returns 0 if the piece on specified row and col is under attack by any opponent piece
      * Returns 1 if the piece is safe
-     * Function is used for calculateScore function. */
-
-    for(int i=0; i<8; ++i) {
-        for(int j=0; j<8; ++j) {
-            if(board[i][j].getColor() != color && board[i][j].getType() != PieceType::Empty) {
-                if(isLegalMove(i,j,row,col)) {
-                    // Some opponent piece has a valid move to this piece, piece not safe
-                    return false;
-                }
-            }
-        }
-    }
+     * It is a single lookup in the attack maps. */
 
-    // Piece is safe
-    return true;
+    // Piece is safe if no opponent piece has a valid move to it
+    return !(attackMap[color == 0 ? 1 : 0] & squareBit(toSquare(row, col)));
 }
 
 double Board::calculateScore(int color) {
     // Calculates the overall goodness score of the specified color's pieces.
-    // Add points for each piece that exists, reduce half of the piece's point if piece is not safe
-
-    double score = 0;
-
-    const double pawnScore = 1.0;
-    const double knightScore = 3.0;
-    const double bishopScore = 3.0;
-    const double rookScore = 5.0;
-    const double queenScore = 9.0;
-    const double kingScore = 500.0; // Prioritize King's safety
-
-    PieceType type;
-    int currentPieceColor;
-
-    // Go through all the slots on the board
-    for(int k=0;k<8;++k) {
-        for(int m=0;m<8;++m) {
-            type = board[k][m].getType();
-            currentPieceColor = board[k][m].getColor();
-
-            // Only check the specified color's pieces
-            if (currentPieceColor == color) {
-                switch (type) {
-                    case PieceType::Empty:
-                        break;
-                    case PieceType::Pawn:
-                        score += pawnScore;
-                        if (isPieceSafe(k, m, color) == 0)
-                            score -= pawnScore / 2.0;
-                        break;
-                    case PieceType::Rook:
-                        score += rookScore;
-                        if (isPieceSafe(k, m, color) == 0)
-                            score -= rookScore / 2.0;
-                        break;
-                    case PieceType::Knight:
-                        score += knightScore;
-                        if (isPieceSafe(k, m, color) == 0)
-                            score -= knightScore / 2.0;
-                        break;
-                    case PieceType::Bishop:
-                        score += bishopScore;
-                        if (isPieceSafe(k, m, color) == 0)
-                            score -= bishopScore / 2.0;
-                        break;
-                    case PieceType::Queen:
-                        score += queenScore;
-                        if (isPieceSafe(k, m, color) == 0)
-                            score -= queenScore / 2.0;
-                        break;
-                    case PieceType::King:
-                        //score += kingScore;
-                        if(isPieceSafe(k, m, color) == 0)
-                            score -= kingScore;
-                        break;
-                    default:
-                        break;
-                }
-            }
-        }
-    }
-
+    // The piece values on their squares are already added up by placePiece and removePiece.
 
-
-    return score;
+    // Middlegame values count fully with every piece on the board, endgame values once only Kings and pawns are left
+    int phase = gamePhase < MAX_PHASE ? gamePhase : MAX_PHASE;
+    return (middlegameScore[color] * phase + endgameScore[color] * (MAX_PHASE - phase)) / (100.0 * MAX_PHASE);
 }
 
-void Board::suggestMove(int color) {
-    int best_old_row, best_old_col, best_new_row, best_new_col;
+int Board::evaluate(int color) {
+    int opponent = color == 0 ? 1 : 0;
 
-    // Start the score from the min integer since it's looking for HIGHER scores.
-    double highestScore = INT_MIN;
-    double currentScore;
+    // Difference of both colors' scores, in hundredths of a pawn
+    double score = calculateScore(color) - calculateScore(opponent);
 
-    // If there are multiple scores with the same score values, save them here.
-    vector<Move> bestMoves;
+    return static_cast<int>(score * 100.0);
+}
 
-    // Create a seed for the rand() function
-    std::srand(time(nullptr));
+void Board::suggestMove(int color, Search &search, const SearchLimits &limits, OpeningBook *book,
+                        const SearchResult *pondered) {
+    // The search plays the moves of the side to move
+    if(color != sideToMove) {
+        cout << "No move to suggest, it is not this color's turn.\n";
+        return;
+    }
 
-    // Loop through every piece
-    for (int i = 0; i < 8; ++i) {
-        for (int j = 0; j < 8; ++j) {
-            // When a piece is found from the same color
-            if (board[i][j].getType() != PieceType::Empty && board[i][j].getColor() == color) {
-                // Check for all the legal moves of the piece and save the one with the best possible score
-                for (int k = 0; k < 8; ++k) {
-                    for (int m = 0; m < 8; ++m) {
-                        // Make this move and calculate the score of it
-                        if(movePiece(i,j,k,m)) {
-                            currentScore = calculateScore(color);
-                            if (currentScore >= highestScore) {
-                                if (currentScore > highestScore) {
-                                    // Clear the previous saved low scores, there is a lower one
-                                    highestScore = currentScore;
-                                    bestMoves.clear();
-                                }
-                                // Push the equal score producing moves into the bestMoves vector
-                                bestMoves.push_back({ i, j, k, m });
-                            }
+    Move bookMove;
+    if(book != nullptr && book->pickMove(*this, bookMove)) {
+        cout << "Suggested move: " << moveToString(bookMove) << " (from the opening book)" << endl;
+        return;
+    }
 
-                            // Revert the move before continuing for other moves
-                            revertMove();
-                        }
-                    }
-                }
-            }
+    // The background search already searched this position. Its move is given right away if it went as far as the
+    // limits ask (the depth, the nodes or the time), otherwise the search goes on with what is left of the budget: the
+    // depths it finished are found again quickly in the transposition table.
+    SearchLimits remaining = limits;
+    if(pondered != nullptr) {
+        int ponderedTime = static_cast<int>(pondered->seconds * 1000);
+        if((limits.depth > 0 && pondered->depth >= limits.depth) || (limits.nodes > 0 && pondered->nodes >= limits.nodes)
+           || (limits.moveTime > 0 && ponderedTime >= limits.moveTime)) {
+            cout << "Suggested move: " << moveToString(pondered->bestMove) << " (searched while waiting, depth "
+                 << pondered->depth << ")" << endl;
+            // The statistics are the background search's, the last one the search made
+            if(search.getStatsEnabled())
+                search.getStats().print(cout);
+            return;
         }
+        if(limits.nodes > 0)
+            remaining.nodes = limits.nodes - pondered->nodes;
+        if(limits.moveTime > 0)
+            remaining.moveTime = limits.moveTime - ponderedTime;
     }
 
-    int rand = std::rand() % bestMoves.size();
-    best_old_row = bestMoves[rand].old_row;
-    best_old_col = bestMoves[rand].old_col;
-    best_new_row = bestMoves[rand].new_row;
-    best_new_col = bestMoves[rand].new_col;
+    SearchResult result = search.think(*this, remaining);
 
+    // No move is possible (the game is over)
+    if(result.bestMove.from == result.bestMove.to) {
+        cout << "No move to suggest.\n";
+        return;
+    }
 
     // Print the Chess notation of the suggested move
-    cout << "Suggested move: "
-         << static_cast<char>(best_old_col + 'a')
-         << 8 - best_old_row
-         << static_cast<char>(best_new_col + 'a')
-         << 8 - best_new_row << endl;
+    cout << "Suggested move: " << moveToString(result.bestMove) << endl;
+    if(search.getStatsEnabled())
+        search.getStats().print(cout);
 }
 
 
@@ -579,8 +1264,10 @@ void Board::saveToFile(int turn) const {
     // Precondition: This function assumes that there is a folder  named "saves" in the same directory of the project.
     // Saves the current layout of the Chess board into a txt file.
 
-    srand(time(nullptr));
-    int random4digit = (std::rand() % 9000) + 1000;
+    // A generator of its own instead of srand/rand: reseeding the global one on every save changes the random numbers
+    // of everything else in the program, and it is not safe when several games run on different threads
+    std::mt19937 random(std::random_device{}());
+    int random4digit = std::uniform_int_distribution<int>(1000, 9999)(random);
     string fileID = std::to_string(random4digit);
     string fileName = "saves/" + fileID + ".txt";
 
@@ -601,20 +1288,10 @@ void Board::saveToFile(int turn) const {
 
     // File is open
 
-    // Write whose turn is it while saving the board to start of the file
-    outputStream << turn << "\n";
-
-    int typeInt;
-    for(int i=0;i<8;++i) {
-        for(int j=0;j<8;++j) {
-            // Write row, col type, color to each line for each piece
-            // Cast the type PieceType enum class into it's integer representation and save it that way
-            typeInt = static_cast<int>(board[i][j].getType());
-            if(typeInt != 6) // skip Empty slots, they will be defaulted when loading
-                outputStream << i << "," << j << "," << typeInt << "," << board[i][j].getColor() << "\n";
-
-        }
-    }
+    // The FEN keeps the castling rights, the en passant square and the move counters too. The side to move is the turn.
+    string fen = toFen();
+    fen[fen.find(' ') + 1] = turn == 0 ? 'w' : 'b';
+    outputStream << fen << "\n";
 
     cout << "Game save file is created. It be loaded with the ID: " << fileID << "\n\n";
 
@@ -630,40 +1307,313 @@ int Board::loadFromFile() {
     cout << "Enter a save file ID: ";
     getline(std::cin, fileName);
 
-    fileName = "saves/" + fileName + ".txt";
-
-    // Check if the file can be opened for reading
-    ifstream inputStream(fileName.c_str());
-    if (!inputStream.is_open()) {
+    int whoseTurn = loadSave("saves/" + fileName + ".txt");
+    if(whoseTurn == -1) {
         cout << "Can't find the save file. Make sure the ID is correct. Example input: 1516\n"
                 "Please write \"load\" again if you wish to try again.\n";
         return -1;
     }
 
+    cout << "Board loaded from the specified save successfully.\n\n";
+
+    return whoseTurn;
+}
+
+int Board::loadSave(const string &fileName) {
+    // Check if the file can be opened for reading
+    ifstream inputStream(fileName.c_str());
+    if (!inputStream.is_open())
+        return -1;
+
 
     // File is open to read
 
+    // Saves are a FEN line, the older ones start with a line that only has the turn
+    string firstLine;
+    getline(inputStream, firstLine);
+    while(!firstLine.empty() && isspace(static_cast<unsigned char>(firstLine.back())))
+        firstLine.pop_back();
+    if(firstLine != "0" && firstLine != "1")
+        return setFromFen(firstLine) ? sideToMove : -1;
+
     // Clear the current board to load the new one to it
     clearBoard();
 
-    int whoseTurn = -1;
+    int whoseTurn = firstLine == "0" ? 0 : 1;
     int rowValue, colValue, typeValue, colorValue;
     char c;
 
-    // Read the turn which is at the start of the file
-    inputStream >> whoseTurn;
-
     // Read the pieces locations and type, values are stored as row, col, type, color
     while(inputStream.good() && inputStream >> rowValue >> c >> colValue >> c >> typeValue >> c >> colorValue) {
+        // Skip the lines that don't describe a piece on the board, and the pieces beyond the 16 a color can have
+        if(rowValue < 0 || rowValue > 7 || colValue < 0 || colValue > 7 || colorValue < 0 || colorValue > 1
+           || pieceCount[colorValue] == 16)
+            continue;
+
         // Update the board according to the values read.
-        board[rowValue][colValue].setType(typeValue);
-        board[rowValue][colValue].setColor(colorValue);
+        Piece piece;
+        piece.setType(typeValue);
+        piece.setColor(colorValue);
+        removePiece(toSquare(rowValue, colValue));
+        if(piece.getType() != PieceType::Empty)
+            placePiece(toSquare(rowValue, colValue), piece);
     }
 
-    // Update the previousBoard to be the same as the new created board.
-    previousBoard = board;
+    computeAttackMaps();
 
-    cout << "Board loaded from the specified save successfully.\n\n";
+    if(whoseTurn == 0 || whoseTurn == 1)
+        sideToMove = whoseTurn;
+    hashKey = computeHashKey();
 
     return whoseTurn;
 }
+
+bool Board::setFromFen(const string &fen) {
+    std::istringstream stream(fen);
+    string placement, side, castling = "-", enPassant = "-";
+
+    // Piece placement and side to move are required, castling rights and en passant square can be left out
+    if(!(stream >> placement >> side))
+        return false;
+    stream >> castling >> enPassant;
+
+    // Read the piece placement row by row from row 0 (rank 8), check everything before changing the board
+    Piece squares[64];
+    int row = 0, col = 0;
+    for(char c : placement) {
+        if(c == '/') {
+            if(col != 8 || row == 7)
+                return false;
+            ++row;
+            col = 0;
+        } else if(c >= '1' && c <= '8') {
+            col += c - '0';
+            if(col > 8)
+                return false;
+        } else {
+            Piece piece = pieceFromSymbol(c);
+            if(piece.getType() == PieceType::Empty || col > 7)
+                return false;
+            squares[toSquare(row, col++)] = piece;
+        }
+    }
+    if(row != 7 || col != 8 || (side != "w" && side != "b"))
+        return false;
+
+    int enPassantValue = -1;
+    if(enPassant != "-") {
+        if(enPassant.length() != 2 || enPassant[0] < 'a' || enPassant[0] > 'h' || enPassant[1] < '1' || enPassant[1] > '8')
+            return false;
+        enPassantValue = toSquare('8' - enPassant[1], enPassant[0] - 'a');
+    }
+    int sideValue = side == "w" ? 0 : 1;
+    if(!isValidSetup(squares, enPassantValue, sideValue))
+        return false;
+
+    int castlingValue = 0;
+    const string castlingLetters = "KQkq";
+    for(int i=0; i<4; ++i) {
+        if(castling.find(castlingLetters[i]) != string::npos)
+            castlingValue |= 1 << i;
+    }
+
+    // The counters are two numbers in a FEN, and the hmvc and fmvn operations in an EPD line (like "hmvc 0; fmvn 1;")
+    int halfmove = 0, fullmove = 1;
+    string word;
+    while(stream >> word) {
+        if(word == "hmvc" || word == "fmvn") {
+            int value;
+            if(stream >> value && value >= 0)
+                (word == "hmvc" ? halfmove : fullmove) = value;
+        } else if(word.find_first_not_of("0123456789") == string::npos) {
+            // The two numbers at the end of a FEN
+            halfmove = atoi(word.c_str());
+            if(stream >> word && word.find_first_not_of("0123456789") == string::npos)
+                fullmove = atoi(word.c_str());
+        }
+    }
+
+    setPosition(squares, castlingValue, enPassantValue, sideValue, halfmove, fullmove < 1 ? 1 : fullmove);
+    return true;
+}
+
+bool Board::isValidSetup(const Piece squares[64], int enPassant, int side) {
+    int kings[2] = { 0, 0 };
+    int pieceTotal[2] = { 0, 0 };
+    for(int square=0; square<64; ++square) {
+        if(squares[square].getType() == PieceType::Empty)
+            continue;
+        int color = squares[square].getColor();
+        ++pieceTotal[color];
+        if(squares[square].getType() == PieceType::King)
+            ++kings[color];
+    }
+    for(int color=0; color<2; ++color) {
+        if(kings[color] != 1 || pieceTotal[color] > 16)
+            return false;
+    }
+
+    // The square a pawn of the other color skipped: rank 6 (row 2) when white is to move, rank 3 (row 5) when black is
+    return enPassant < 0 || rowOf(enPassant) == (side == 0 ? 2 : 5);
+}
+
+void Board::setPosition(const Piece squares[64], int castling, int enPassant, int side, int halfmove, int fullmove) {
+    clearBoard();
+
+    for(int square=0; square<64; ++square) {
+        Piece piece = squares[square];
+        if(piece.getType() == PieceType::Empty)
+            continue;
+
+        // Kings and Rooks without a castling right count as moved, so canCastle doesn't allow that castling
+        if(piece.getType() == PieceType::King || piece.getType() == PieceType::Rook) {
+            int kingSideRight = castling & (1 << (piece.getColor() * 2));
+            int queenSideRight = castling & (2 << (piece.getColor() * 2));
+            bool hasRight;
+            if(piece.getType() == PieceType::King)
+                hasRight = kingSideRight || queenSideRight;
+            else
+                hasRight = (colOf(square) == 7 && kingSideRight) || (colOf(square) == 0 && queenSideRight);
+            piece.setMoved(hasRight ? 0 : 1);
+        }
+
+        placePiece(square, piece);
+    }
+
+    enPassantSquare = enPassant;
+    sideToMove = side;
+    halfmoveClock = halfmove;
+    fullmoveNumber = fullmove;
+    computeAttackMaps();
+    hashKey = computeHashKey();
+}
+
+string Board::toFen() const {
+    string fen;
+
+    // Piece placement from row 0 (rank 8), a digit for each run of empty squares
+    for(int row=0; row<8; ++row) {
+        int empty = 0;
+        for(int col=0; col<8; ++col) {
+            Piece piece = getPiece(row, col);
+            if(piece.getType() == PieceType::Empty) {
+                ++empty;
+                continue;
+            }
+            if(empty > 0)
+                fen += static_cast<char>('0' + empty);
+            empty = 0;
+            fen += piece.getSymbol();
+        }
+        if(empty > 0)
+            fen += static_cast<char>('0' + empty);
+        if(row < 7)
+            fen += '/';
+    }
+
+    fen += sideToMove == 0 ? " w " : " b ";
+
+    int rights = castlingRights();
+    const string castlingLetters = "KQkq";
+    for(int i=0; i<4; ++i) {
+        if(rights & (1 << i))
+            fen += castlingLetters[i];
+    }
+    if(rights == 0)
+        fen += '-';
+
+    if(enPassantSquare >= 0) {
+        fen += ' ';
+        fen += static_cast<char>('a' + colOf(enPassantSquare));
+        fen += static_cast<char>('8' - rowOf(enPassantSquare));
+    } else {
+        fen += " -";
+    }
+
+    return fen + " " + std::to_string(halfmoveClock) + " " + std::to_string(fullmoveNumber);
+}
+
+string Board::toEpd() const {
+    // The same as the FEN without the two numbers at the end
+    string fen = toFen();
+    size_t counters = fen.rfind(' ', fen.rfind(' ') - 1);
+    return fen.substr(0, counters) + " hmvc " + std::to_string(halfmoveClock) + "; fmvn " + std::to_string(fullmoveNumber) + ";";
+}
+
+PositionRecord Board::toRecord() const {
+    PositionRecord record = PositionRecord();
+
+    for(int i=0; i<8; ++i)
+        record.occupancy[i] = static_cast<uint8_t>(occupancy >> (i * 8));
+
+    int index = 0;
+    Bitboard b = occupancy;
+    while(b) {
+        Piece piece = Piece::fromCode(mailbox[popLowestSquare(b)]);
+        int code = static_cast<int>(piece.getType()) | (piece.getColor() << 3);
+        record.pieces[index / 2] |= static_cast<uint8_t>(code << ((index % 2) * 4));
+        ++index;
+    }
+
+    record.sideToMove = static_cast<uint8_t>(sideToMove);
+    record.castling = static_cast<uint8_t>(castlingRights());
+    record.enPassant = enPassantSquare >= 0 ? static_cast<uint8_t>(enPassantSquare) : PositionRecord::NO_EN_PASSANT;
+    record.halfmoveClock = static_cast<uint8_t>(halfmoveClock < 255 ? halfmoveClock : 255);
+    record.fullmoveNumber[0] = static_cast<uint8_t>(fullmoveNumber);
+    record.fullmoveNumber[1] = static_cast<uint8_t>(fullmoveNumber >> 8);
+    return record;
+}
+
+bool Board::setFromRecord(const PositionRecord &record) {
+    Bitboard recordOccupancy = 0;
+    for(int i=0; i<8; ++i)
+        recordOccupancy |= static_cast<Bitboard>(record.occupancy[i]) << (i * 8);
+
+    if(popCount(recordOccupancy) > 32 || record.sideToMove > 1 || record.castling > 15
+       || (record.enPassant != PositionRecord::NO_EN_PASSANT && record.enPassant > 63))
+        return false;
+
+    // Check every piece code before changing the board
+    Piece squares[64];
+    int index = 0;
+    Bitboard b = recordOccupancy;
+    while(b) {
+        int square = popLowestSquare(b);
+        int code = (record.pieces[index / 2] >> ((index % 2) * 4)) & 15;
+        ++index;
+        if((code & 7) > static_cast<int>(PieceType::King))
+            return false;
+        squares[square] = Piece(static_cast<PieceType>(code & 7), code >> 3);
+    }
+
+    int enPassant = record.enPassant == PositionRecord::NO_EN_PASSANT ? -1 : record.enPassant;
+    if(!isValidSetup(squares, enPassant, record.sideToMove))
+        return false;
+    int fullmove = record.fullmoveNumber[0] | (record.fullmoveNumber[1] << 8);
+    setPosition(squares, record.castling, enPassant, record.sideToMove, record.halfmoveClock, fullmove < 1 ? 1 : fullmove);
+    return true;
+}
+
+bool writePositionRecords(const string &fileName, const vector<PositionRecord> &records) {
+    ofstream outputStream(fileName.c_str(), std::ios::binary);
+    if(!outputStream.is_open())
+        return false;
+    outputStream.write(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(PositionRecord));
+    return outputStream.good();
+}
+
+bool readPositionRecords(const string &fileName, vector<PositionRecord> &records) {
+    ifstream inputStream(fileName.c_str(), std::ios::binary | std::ios::ate);
+    if(!inputStream.is_open())
+        return false;
+
+    std::streamoff size = inputStream.tellg();
+    if(size < 0 || size % sizeof(PositionRecord) != 0)
+        return false;
+
+    // The whole file in one read, the records need no parsing until a position is set up from one
+    records.resize(static_cast<size_t>(size / sizeof(PositionRecord)));
+    inputStream.seekg(0);
+    inputStream.read(reinterpret_cast<char *>(records.data()), size);
+    return inputStream.good();
+}
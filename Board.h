@@ -3,6 +3,7 @@
 #ifndef CHESS_BOARD_H
 #define CHESS_BOARD_H
 
+#include <array>
 #include <iostream>
 #include <vector>
 #include <string>
@@ -11,7 +12,11 @@
 #include <ctime>
 #include <climits>
 #include <fstream>
+#include <sstream>
 #include "Piece.h"
+#include "Bitboard.h"
+#include "Zobrist.h"
+#include "Evaluation.h"
 
 //using namespace std;
 
@@ -24,6 +29,80 @@ using std::time;
 using std::ofstream;
 using std::ifstream;
 
+// A single move of a piece. Squares are numbered row * 8 + col (see Bitboard.h).
+struct Move {
+    uint8_t from;
+    uint8_t to;
+    PieceType promotion; // The piece a pawn turns into on the last row, PieceType::Empty for every other move
+};
+
+// Fixed-size list that the move generator fills, so generating moves needs no allocation.
+struct MoveList {
+    Move moves[256];
+    int count;
+
+    MoveList() : count(0) {}
+
+    void add(int from, int to, PieceType promotion = PieceType::Empty) {
+        moves[count].from = static_cast<uint8_t>(from);
+        moves[count].to = static_cast<uint8_t>(to);
+        moves[count].promotion = promotion;
+        ++count;
+    }
+};
+
+// Everything makeMove changes that can't be found again from the move itself, so unmakeMove can restore it.
+struct UndoInfo {
+    Move move;
+    PieceType captured;   // Type of the captured piece, PieceType::Empty if the move didn't capture
+    int enPassantSquare;  // En passant square before the move
+    Bitboard movedPieces; // Moved squares before the move
+    uint64_t hashKey;     // Zobrist key before the move
+    int halfmoveClock;    // Halfmove clock before the move
+};
+
+// Fixed-size binary record of a position for storing many of them: 32 bytes, made only of bytes so the files are the
+// same on every machine and a file of records is read with a single read into an array.
+//  - occupancy: the occupied squares as a little-endian bitboard
+//  - pieces: a 4-bit code for each occupied square in square order (low half of the byte first), the type in the low
+//    3 bits and the color in the high bit. A color can't have more than 16 pieces, so 32 codes are always enough.
+//  - castling: the bits of zobristCastling, enPassant: the square or NO_EN_PASSANT, fullmoveNumber: little-endian
+struct PositionRecord {
+    static const uint8_t NO_EN_PASSANT = 0xFF;
+
+    uint8_t occupancy[8];
+    uint8_t pieces[16];
+    uint8_t sideToMove;
+    uint8_t castling;
+    uint8_t enPassant;
+    uint8_t halfmoveClock;
+    uint8_t fullmoveNumber[2];
+    uint8_t reserved[2];
+};
+
+static_assert(sizeof(PositionRecord) == 32, "PositionRecord must stay 32 bytes");
+
+// Writes the records to the file / reads every record of the file into the vector. Both return false if the file
+// can't be written or read (or its size is not a whole number of records).
+bool writePositionRecords(const string &fileName, const vector<PositionRecord> &records);
+bool readPositionRecords(const string &fileName, vector<PositionRecord> &records);
+
+// Which moves generateMoves adds: all of them, only the captures and promotions (the moves that change the material),
+// or only the other moves
+enum class MoveGenType { All, Captures, Quiets };
+
+// State of the game for the side to move: it has a legal move, or it has none and is checkmated or stalemated
+enum class GameStatus { Ongoing, Checkmate, Stalemate };
+
+class Search;
+class OpeningBook;
+struct SearchLimits;
+struct SearchResult;
+class TranspositionTable;
+
+// Returns the chess notation of the move like e2e4, with the promotion piece added at the end like e7e8q
+string moveToString(const Move &move);
+
 class Board {
 public:
     // Constructor initializes the Chess board's starting state using createBoard function.
@@ -31,22 +110,70 @@ public:
 
     void printBoard() const;
 
-    /* Checks if the input is another function like "save", "load", "suggest" or "exit", if so, calls the according function
+    /* Checks if the input is another function like "save", "load", "undo", "suggest" or "exit", if so, calls the according function
     * Otherwise, checks if the input is a 'valid' chess notation like e2e4
     * Returns 0 if invalid input
-    * Returns 1 if valid Chess notation input
+    * Returns 1 if valid Chess notation input (a fifth letter like e7e8n picks the piece of a pawn promotion, Queen otherwise)
     * Returns 2 if the user wants a move suggestion (if input is "suggest")
     * Returns 3 if user wants to save the current board to file (input is "save")
     * Returns 4 if user wants to load a game from file (input is "load")
+    * Returns 5 if user wants to take back the last move (input is "undo")
     * Returns -1 if the user want to exit the game (if input is "exit") */
-    int inputMove(string &input, int &old_row, int &old_col, int &new_row, int &new_col, const int& status) const;
+    int inputMove(string &input, int &old_row, int &old_col, int &new_row, int &new_col, const int& status,
+                  PieceType &promotion) const;
 
     // Move piece from old row, old_col to new row, new_col, checks if the move is legal using isLegalMove function
-    // if the move is legal and was successful, returns true, otherwise false.
-    bool movePiece(int old_row, int old_col, int new_row, int new_col);
+    // (and isLegal, a move can't leave the King under attack), if the move is legal and was successful, returns true,
+    // otherwise false.
+    // A pawn reaching the last row turns into the promotion piece.
+    bool movePiece(int old_row, int old_col, int new_row, int new_col, PieceType promotion = PieceType::Queen);
+
+    // Fills the list with every pseudo-legal move of the specified color: the moves follow the rules of each piece
+    // (including castling, en passant and promotions) but they may leave the color's own King under attack.
+    // The type picks only the captures (en passant and every promotion included) or only the other moves.
+    void generateMoves(int color, MoveList &moveList, MoveGenType type = MoveGenType::All) const;
+
+    // Fills the list with the legal moves of the specified color (the side to move), the moves don't have to be made to
+    // find out if they leave the King under attack. The checking pieces and the pinned pieces (the only piece between
+    // their King and an opponent Rook, Bishop or Queen) are found once: when in check the other pieces can only take the
+    // checking piece or block it, a pinned piece can only move along the pin, and the King only to squares that are not
+    // attacked. The type picks the captures or the quiet moves like generateMoves.
+    void generateLegalMoves(int color, MoveList &moveList, MoveGenType type = MoveGenType::All) const;
+
+    // Returns true if the specified color (the side to move) has at least one legal move. Stops at the first one it
+    // finds, looking at the King's moves first, then (when in check) at the moves that take the checking piece, then at
+    // the ones that block it. No move is made or listed.
+    bool hasLegalMove(int color) const;
+
+    // Returns whether the specified color (the side to move) is checkmated, stalemated or can go on playing
+    GameStatus gameStatus(int color) const;
+
+    // Precondition: the move is pseudo-legal (from generateMoves, or checked with isPseudoLegal).
+    // Returns true if the move doesn't leave the moving color's King under attack, without making it.
+    bool isLegal(const Move &move) const;
+
+    // Returns true if generateMoves could give the move for the side to move in this position. Used to check moves
+    // that come from somewhere else (the transposition table, other positions of the search) before making them.
+    bool isPseudoLegal(const Move &move) const;
+
+    // Returns true if the move takes a piece (en passant included)
+    bool isCapture(const Move &move) const;
+
+    // Finds the legal move of the side to move written in coordinate notation (e2e4, e7e8q) or in standard algebraic
+    // notation (Nf3, exd5, O-O, e8=Q+). Returns false if no legal move, or more than one, matches the notation.
+    bool parseMove(const string &notation, Move &move);
 
-    // Reverts the last move done by any player
-    void revertMove();
+    // Reverts the last move done by any player, can be called again to revert the moves before it.
+    // Returns false if there is no move to revert.
+    bool revertMove();
+
+    // Makes the move without checking if it is legal, the move should come from generateMoves.
+    // The move is pushed to the undo stack, so unmakeMove can take it back. The stack grows as needed, a long game
+    // followed by a deep search can't run out of room.
+    void makeMove(const Move &move);
+
+    // Takes back the last move made by makeMove or movePiece
+    void unmakeMove();
 
     /* Returns -2 if something is wrong (King not found)
      * Returns  0 for CHECK - the King is not safe and there is at least one move to save it
@@ -57,14 +184,26 @@ public:
     /* Returns -2 if something is wrong (King not found)
      * Returns -1 for CHECKMATE - the King is not safe and no move can save it
      * Returns  0 for CHECK - the King is not safe and there is at least one move to save it
-     * Returns  1 if the King is safe */
-    int isCheckmate(int color);
+     * Returns  1 if the King is safe
+     * hasLegalMove stops at the first move that saves the King, none of them has to be tried. If a transposition table is
+     * given, a checkmate stored by the search is found without looking for a move, and a found checkmate is stored
+     * for the search. */
+    int isCheckmate(int color, TranspositionTable *table = nullptr);
+
+    // Suggests a move for the current color: searches the position with the search within the limits (time, nodes or
+    // depth) and prints the best move found. If an opening book is given and has the position, one of its moves is
+    // suggested right away without searching. If the position was already searched in the background (see Ponder.h),
+    // the pondered result is suggested right away when it reached the limits, otherwise the search only spends the rest
+    // of the budget. The search's statistics are printed after the move if they are on.
+    void suggestMove(int color, Search &search, const SearchLimits &limits, OpeningBook *book = nullptr,
+                     const SearchResult *pondered = nullptr);
 
-    // Suggests a move where the current color has the best score for the next move.
-    void suggestMove(int color);
+    // Returns the score of the position from the specified color's view in centipawns (positive is good for the color).
+    // The position is taken as it is, captures that are possible next are not looked at.
+    int evaluate(int color);
 
     // Precondition: This function assumes that there is a folder  named "saves" in the same directory of the project.
-    // Saves the current layout of the Chess board into a txt file.
+    // Saves the current position into a txt file as a single FEN line, the turn is the side to move.
     void saveToFile(int turn) const;
 
     // Precondition: This function assumes that there is a folder named "saves" in the same directory of the project.
@@ -72,40 +211,198 @@ public:
     // If the load was successful, returns whose turn is it (0 for white 1 for black), otherwise returns -1.
     int loadFromFile();
 
+    // Loads the save file at the given path without asking or printing anything. The file is a FEN line, or in the
+    // older format of a turn line and a row,col,type,color line for each piece (that one has no castling rights).
+    // Returns whose turn is it like loadFromFile, or -1 and keeps the board as it was if the file can't be read.
+    int loadSave(const string &fileName);
+
+    // Sets up the position described by the FEN string (like "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1").
+    // Castling rights become the moved values of the Kings and Rooks. Returns false and keeps the board as it was if the
+    // string is not a valid FEN, or not a position the board can hold (see isValidSetup). The move counters at the end
+    // are optional. EPD lines are read too: the counters are
+    // taken from the hmvc and fmvn operations if they have them, the other operations are skipped.
+    bool setFromFen(const string &fen);
+
+    // Returns the FEN string of the position, setFromFen gives back the same position from it
+    string toFen() const;
+
+    // Returns the EPD line of the position: the first four fields of the FEN and the counters as operations
+    string toEpd() const;
+
+    // Packs the position into a binary record / sets up the position of the record. setFromRecord returns false and
+    // keeps the board as it was if the record is not a valid position.
+    PositionRecord toRecord() const;
+    bool setFromRecord(const PositionRecord &record);
+
+    // Returns whose turn is it (0 for white 1 for black), makeMove and unmakeMove change it
+    int getSideToMove() const { return sideToMove; }
+
+    // Returns the number of moves since the last capture or pawn move (for the fifty-move rule), and the number of the
+    // full move (starting at 1, one more after every black move). makeMove and unmakeMove keep both up to date.
+    int getHalfmoveClock() const { return halfmoveClock; }
+    int getFullmoveNumber() const { return fullmoveNumber; }
+
+    // Returns the castling rights of the position as the bits of zobristCastling: a right exists while the King and
+    // that Rook stand on their starting squares and were never moved
+    int castlingRights() const;
+
+    // Returns the square a pawn skipped with its two squares move on the last move, -1 if there is none
+    int getEnPassantSquare() const { return enPassantSquare; }
+
+    // Returns the Zobrist key of the position (see Zobrist.h), kept up to date by makeMove and unmakeMove.
+    // Positions with the same pieces, side to move, castling rights and en passant capture have the same key.
+    uint64_t getHashKey() const { return hashKey; }
+
+    // Returns the Zobrist key computed from nothing, it is always equal to getHashKey()
+    uint64_t computeHashKey() const;
+
+    // Returns the piece on the specified row and col (an Empty piece if there is none)
+    Piece getPiece(int row, int col) const;
+
+    // Returns the bitboard of all the squares attacked by the specified color's pieces
+    Bitboard attackedSquares(int color) const;
+
+    // Returns how many pieces of the specified color attack the square
+    int attackerCount(int square, int color) const;
+
+    // Returns the square of the specified color's King, -1 if the color has no King on the board
+    int getKingSquare(int color) const { return kingSquare[color]; }
+
+    // Returns how many pieces the specified color has, and the square of each of them (index from 0 to count - 1)
+    int getPieceCount(int color) const { return pieceCount[color]; }
+    int getPieceSquare(int color, int index) const { return pieceList[color][index]; }
+
 private:
+    // bench_board times some of the private functions below on their own
+    friend struct BoardBenchAccess;
+
     // This function is only called by the constructor
     void createBoard();
 
     // Sets all the board pieces to PieceType::Empty
     void clearBoard();
 
+    // Sets up a checked position from the pieces of each square and the state of a FEN or a record. Kings and Rooks
+    // without a castling right (bits of zobristCastling) count as moved.
+    void setPosition(const Piece squares[64], int castling, int enPassant, int side, int halfmove, int fullmove);
+
+    // Returns true if setPosition can set up the pieces: exactly one King of each color, no more than 16 pieces of a
+    // color, and an en passant square (-1 for none) on the row a two squares move of the other color skips
+    static bool isValidSetup(const Piece squares[64], int enPassant, int side);
+
+    // Moves of generateMoves (legalOnly false) and generateLegalMoves (legalOnly true)
+    void generateMoveList(int color, MoveList &moveList, MoveGenType type, bool legalOnly) const;
+
+    // Finds the pieces checking the color's King, the squares where a piece other than the King has to move to when in
+    // check (the checking piece or a square between it and the King, every square when not in check, none in double
+    // check), the pinned pieces and the squares each of them can move to (between its King and the pinning piece, the
+    // pinning piece included). Only the pinned pieces' entries of pinRays are set. Precondition: the color has a King.
+    void findChecksAndPins(int color, Bitboard &checkers, Bitboard &checkMask, Bitboard &pinned,
+                           Bitboard pinRays[64]) const;
+
+    // Returns true if the en passant capture of the pawn on from doesn't leave the King under attack. Both pawns leave
+    // their row, so a Rook or Queen on that row can attack the King through them, which no pin mask shows.
+    bool isLegalEnPassant(int from, int color) const;
+
     // Returns true if the input move is a legal chess move. This function is called by the movePiece function.
     bool isLegalMove(int old_row, int old_col, int new_row, int new_col) const;
 
-    // Returns true if the path of a piece is empty. This function is called by the isLegalMove function.
+    // Returns true if the squares between the two slots are empty and the new slot has no piece of the same color.
+    // isLegalMove asks the attack tables instead, they answer the same for every sliding piece with one lookup.
     bool isPathEmpty(int old_row, int old_col, int new_row, int new_col) const;
 
-    // Returns the overall score of the specified color's pieces
+    // Returns true if the King of the specified color can castle to the King side or the Queen side:
+    // King and Rook were never moved, the squares between them are empty and the King doesn't pass an attacked square.
+    bool canCastle(int color, bool kingSide) const;
+
+    // Returns the overall score of the specified color's pieces in pawns: the material and piece-square values kept by
+    // placePiece and removePiece, blended by the game phase. Pieces under attack are left to the quiescence search.
     double calculateScore(int color);
 
     /* Precondition: This function assumes the given row and col is NOT empty.
      * Returns 0 if the piece on specified row and col is under attack by any opponent piece
      * Returns 1 if the piece is safe
-     * Function is used for calculateScore function. */
+     * It is a single lookup in the attack maps. */
     bool isPieceSafe(int row, int col, int color) const;
 
-    // Vectors to hold the current and the previous positions of the chess board
-    vector <vector<Piece> > board;
-    vector <vector<Piece> > previousBoard;
-};
+    // Puts the piece on the (empty) square / removes whatever piece stands on the square.
+    // The attack maps are not updated, makeMove and unmakeMove update them around these calls.
+    void placePiece(int square, const Piece &piece);
+    void removePiece(int square);
 
-// Move struct only for the suggestMove function to use while looking for different moves
-struct Move {
-    int old_row;
-    int old_col;
-    int new_row;
-    int new_col;
-};
+    // Returns the bitboard of the pieces of the specified color that attack the square, the sliding pieces' rays stop at
+    // the occupied squares (the board's, or the given ones to see the position as if pieces were moved)
+    Bitboard attackersOf(int square, int color) const;
+    Bitboard attackersOf(int square, int color, Bitboard occupied) const;
+
+    // Returns the squares attacked by the piece on the square
+    Bitboard pieceAttacks(int square) const;
+
+    // Adds (change = 1) or removes (change = -1) the attacks of the piece on the square to the attack maps
+    void updateAttackCounts(int square, int change);
+
+    // Called before a move changes the pieces on the changed squares: removes the attacks of every piece that can attack
+    // differently after the move, returns the ones that don't stand on a changed square.
+    Bitboard removeAttacksThrough(Bitboard changed);
 
+    // Called after the move: adds the attacks of the pieces now on the changed squares and of the returned pieces above
+    void addAttacksThrough(Bitboard changed, Bitboard stillAttacking);
+
+    // Builds the attack maps from nothing, used after a new position is set up
+    void computeAttackMaps();
+
+    // Returns the part of the Zobrist key that is not the pieces: side to move, castling rights and en passant file.
+    // The en passant file only counts when a pawn of the side to move can capture there.
+    uint64_t stateHashKey() const;
+
+    // Piece code (see Piece.h) of every square, Empty pieces on the empty squares. The mailbox is 64 bytes (the size of a
+    // cache line) and getPiece is a single read. Kept the same as the bitboards by placePiece and removePiece.
+    std::array<uint8_t, 64> mailbox;
+
+    // Bitboards of the current position, one for each color and piece type: pieces[color][type]
+    Bitboard pieces[2][6];
+    // Occupied squares of each color and of both colors together
+    Bitboard colorOccupancy[2];
+    Bitboard occupancy;
+    // Squares whose piece has been moved before (the hasMoved value of the pieces)
+    Bitboard movedPieces;
+    // Square that a pawn skipped with its two squares move on the last move, -1 if there is none
+    int enPassantSquare;
+    // Color of the player to make the next move
+    int sideToMove;
+    // Halfmoves since the last capture or pawn move, and the full move number
+    int halfmoveClock;
+    int fullmoveNumber;
+    // Zobrist key of the position, placePiece and removePiece update the pieces' part of it
+    uint64_t hashKey;
+    // Sums of the middlegame and endgame values of each color's pieces, and the game phase (see Evaluation.h).
+    // placePiece and removePiece update them, so the evaluation doesn't have to visit the pieces.
+    int middlegameScore[2];
+    int endgameScore[2];
+    int gamePhase;
+
+    // Squares of each color's pieces in no particular order (a color can't have more than 16 pieces),
+    // the index of each occupied square in its color's list (-1 for empty squares) and the squares of the Kings.
+    // Kept up to date by placePiece and removePiece, so loops can visit only the pieces that exist.
+    uint8_t pieceList[2][16];
+    int pieceCount[2];
+    int8_t pieceIndex[64];
+    int kingSquare[2];
+
+    // Number of pieces of each color attacking each square, and the squares with at least one attacker of each color.
+    // Both are updated by makeMove and unmakeMove, so finding out if a square is attacked is a single lookup.
+    uint8_t attackCount[2][64];
+    Bitboard attackMap[2];
+
+    // Undo stack of the moves made on this board, the last made move is at the back. It is kept on the heap and holds
+    // only the moves made, so a copy of the board (each search thread makes one) costs a few hundred bytes and the
+    // moves of the game so far, not the whole stack.
+    // Room for UNDO_CAPACITY moves is reserved when the board is set up: a game of 480 moves plus the deepest search
+    // (Search::MAX_DEPTH plies, quiescence included). makeMove only allocates past that, so a longer game can't run
+    // out of room. A copy made with the copy constructor only has room for its moves, but assigning to a board keeps
+    // the room it had, which is how the search threads get the position.
+    static const int UNDO_CAPACITY = 1024;
+    vector<UndoInfo> history;
+};
 
 #endif //CHESS_BOARD_H
@@ -0,0 +1,23 @@
+/* Piece values and piece-square tables of the evaluation.
+ * Every piece has a middlegame and an endgame value that depends on its type and square (material included). A board
+ * adds them up as pieces are placed and removed, and the evaluation blends the two sums by the game phase: with all
+ * the pieces on the board it is the middlegame sum, with only Kings and pawns left it is the endgame sum.
+ * The values are in centipawns, from the PeSTO evaluation (Chess Programming Wiki). */
+
+#ifndef CHESS_EVALUATION_H
+#define CHESS_EVALUATION_H
+
+// Phase of the starting position, the phase is the sum of phaseValue over the pieces on the board
+const int MAX_PHASE = 24;
+
+// Fills the tables below. Safe to call more than once, the tables are only built the first time.
+void initEvaluation();
+
+// Middlegame and endgame value of a piece of the color (0 for white, 1 for black) and type (PieceType as int) on the square
+int middlegameValue(int color, int type, int square);
+int endgameValue(int color, int type, int square);
+
+// How much a piece of the type counts towards the middlegame: 1 for Knights and Bishops, 2 for Rooks, 4 for Queens
+int phaseValue(int type);
+
+#endif //CHESS_EVALUATION_H
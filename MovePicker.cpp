@@ -0,0 +1,131 @@
+#include "MovePicker.h"
+
+namespace {
+    // Piece values used for ordering, indexed by PieceType (the King is the most valuable attacker, it can't be a victim)
+    const int orderValues[7] = { 1, 5, 3, 3, 9, 10, 0 };
+
+    bool sameMove(const Move &a, const Move &b) {
+        return a.from == b.from && a.to == b.to && a.promotion == b.promotion;
+    }
+
+    bool isMove(const Move &move) {
+        return move.from != move.to;
+    }
+}
+
+MovePicker::MovePicker(const Board &board, const Move &hashMove, const Move killers[2], const int history[64][64])
+        : board(board), hashMove(hashMove), history(history), stage(HashMove), capturesOnly(false), current(0) {
+    this->killers[0] = killers[0];
+    this->killers[1] = killers[1];
+}
+
+MovePicker::MovePicker(const Board &board)
+        : board(board), history(nullptr), stage(GenerateCaptures), capturesOnly(true), current(0) {
+    Move noMove = { 0, 0, PieceType::Empty };
+    hashMove = killers[0] = killers[1] = noMove;
+}
+
+bool MovePicker::next(Move &move) {
+    switch(stage) {
+        case HashMove:
+            stage = GenerateCaptures;
+            if(isMove(hashMove) && board.isPseudoLegal(hashMove) && board.isLegal(hashMove)) {
+                move = hashMove;
+                return true;
+            }
+            // No usable hash move, go on with the captures
+            // Fall through
+        case GenerateCaptures:
+            board.generateLegalMoves(board.getSideToMove(), moveList, MoveGenType::Captures);
+            scoreCaptures();
+            current = 0;
+            stage = Captures;
+            // Fall through
+        case Captures:
+            while(current < moveList.count) {
+                move = moveList.moves[pickBest()];
+                if(!sameMove(move, hashMove))
+                    return true;
+            }
+            if(capturesOnly) {
+                stage = Done;
+                return false;
+            }
+            stage = FirstKiller;
+            // Fall through
+        case FirstKiller:
+        case SecondKiller:
+            // Killers come from other positions, they have to be quiet moves that are possible here
+            while(stage != GenerateQuiets) {
+                const Move &killer = killers[stage == FirstKiller ? 0 : 1];
+                stage = stage == FirstKiller ? SecondKiller : GenerateQuiets;
+                if(isMove(killer) && !sameMove(killer, hashMove) && killer.promotion == PieceType::Empty
+                   && board.isPseudoLegal(killer) && !board.isCapture(killer) && board.isLegal(killer)) {
+                    move = killer;
+                    return true;
+                }
+            }
+            // Fall through
+        case GenerateQuiets:
+            board.generateLegalMoves(board.getSideToMove(), moveList, MoveGenType::Quiets);
+            scoreQuiets();
+            current = 0;
+            stage = Quiets;
+            // Fall through
+        case Quiets:
+            while(current < moveList.count) {
+                move = moveList.moves[pickBest()];
+                if(!alreadyGiven(move))
+                    return true;
+            }
+            stage = Done;
+            // Fall through
+        case Done:
+            return false;
+    }
+    return false;
+}
+
+void MovePicker::scoreCaptures() {
+    for(int i=0; i<moveList.count; ++i) {
+        const Move &move = moveList.moves[i];
+        Piece victim = board.getPiece(rowOf(move.to), colOf(move.to));
+        Piece attacker = board.getPiece(rowOf(move.from), colOf(move.from));
+
+        // An en passant capture lands on an empty square but takes a pawn
+        int victimValue = orderValues[static_cast<int>(victim.getType())];
+        if(victim.getType() == PieceType::Empty && colOf(move.from) != colOf(move.to) && attacker.getType() == PieceType::Pawn)
+            victimValue = orderValues[static_cast<int>(PieceType::Pawn)];
+
+        scores[i] = victimValue * 16 - orderValues[static_cast<int>(attacker.getType())];
+        if(move.promotion != PieceType::Empty)
+            scores[i] += orderValues[static_cast<int>(move.promotion)] * 16;
+    }
+}
+
+void MovePicker::scoreQuiets() {
+    for(int i=0; i<moveList.count; ++i)
+        scores[i] = history[moveList.moves[i].from][moveList.moves[i].to];
+}
+
+int MovePicker::pickBest() {
+    // Selection sort one move at a time: only the moves that are actually searched get sorted
+    int best = current;
+    for(int i=current + 1; i<moveList.count; ++i) {
+        if(scores[i] > scores[best])
+            best = i;
+    }
+
+    Move bestMove = moveList.moves[best];
+    int bestScore = scores[best];
+    moveList.moves[best] = moveList.moves[current];
+    scores[best] = scores[current];
+    moveList.moves[current] = bestMove;
+    scores[current] = bestScore;
+
+    return current++;
+}
+
+bool MovePicker::alreadyGiven(const Move &move) const {
+    return sameMove(move, hashMove) || sameMove(move, killers[0]) || sameMove(move, killers[1]);
+}
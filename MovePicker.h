@@ -0,0 +1,53 @@
+/* Move picker of the search: gives the moves of a position one at a time in the order most likely to cause a cutoff.
+ *   1. the hash move (best move stored for the position in the transposition table)
+ *   2. captures and promotions, most valuable victim first and least valuable attacker first among the same victims
+ *   3. killer moves (quiet moves that caused a cutoff at the same ply in other positions)
+ *   4. the other quiet moves, the ones with the highest history score (cutoffs caused before) first
+ * The moves of a stage are only generated when the stage is reached, so a cutoff on the hash move or on a capture
+ * saves generating and scoring the rest. Every move is legal: the stages are generated with generateLegalMoves, and the
+ * hash move and the killers are checked with isLegal.
+ * The quiescence search uses a picker that gives only the captures and promotions (stage 2). */
+
+#ifndef CHESS_MOVEPICKER_H
+#define CHESS_MOVEPICKER_H
+
+#include "Board.h"
+
+class MovePicker {
+public:
+    // The hash move and the killers can be any move (or none, from == to), they are only given if they are legal in the
+    // board's position. history is the history table of the side to move, indexed by from and to squares.
+    MovePicker(const Board &board, const Move &hashMove, const Move killers[2], const int history[64][64]);
+
+    // Picker of only the captures and promotions, most valuable victim first
+    explicit MovePicker(const Board &board);
+
+    // Sets the next move and returns true, returns false when there are no moves left
+    bool next(Move &move);
+
+private:
+    enum Stage { HashMove, GenerateCaptures, Captures, FirstKiller, SecondKiller, GenerateQuiets, Quiets, Done };
+
+    // Scores the generated moves of the current stage
+    void scoreCaptures();
+    void scoreQuiets();
+
+    // Returns the index of the best scored move not given yet, and puts it in front of the others
+    int pickBest();
+
+    // Returns true if the move was already given in an earlier stage
+    bool alreadyGiven(const Move &move) const;
+
+    const Board &board;
+    Move hashMove;
+    Move killers[2];
+    const int (*history)[64];
+
+    Stage stage;
+    bool capturesOnly;
+    MoveList moveList;
+    int scores[256];
+    int current;
+};
+
+#endif //CHESS_MOVEPICKER_H
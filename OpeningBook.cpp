@@ -0,0 +1,146 @@
+#include "OpeningBook.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    // Reads a big-endian number of the given number of bytes
+    uint64_t readBigEndian(const unsigned char *bytes, int count) {
+        uint64_t value = 0;
+        for(int i=0; i<count; ++i)
+            value = (value << 8) | bytes[i];
+        return value;
+    }
+
+    void writeBigEndian(unsigned char *bytes, uint64_t value, int count) {
+        for(int i=count - 1; i>=0; --i) {
+            bytes[i] = static_cast<unsigned char>(value);
+            value >>= 8;
+        }
+    }
+
+    // Promotion pieces in the order of their codes, 0 is no promotion
+    const PieceType promotionTypes[5] = { PieceType::Empty, PieceType::Knight, PieceType::Bishop, PieceType::Rook,
+                                          PieceType::Queen };
+}
+
+OpeningBook::OpeningBook() : entries(nullptr), entryCount(0), mappedSize(0), random(std::random_device()()) {}
+
+OpeningBook::~OpeningBook() {
+    close();
+}
+
+bool OpeningBook::open(const string &fileName) {
+    close();
+
+    int file = ::open(fileName.c_str(), O_RDONLY);
+    if(file < 0)
+        return false;
+
+    struct stat status;
+    if(fstat(file, &status) != 0 || status.st_size <= 0 || status.st_size % ENTRY_SIZE != 0) {
+        ::close(file);
+        return false;
+    }
+
+    // The mapping stays valid after the file is closed
+    void *mapped = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_SHARED, file, 0);
+    ::close(file);
+    if(mapped == MAP_FAILED)
+        return false;
+
+    entries = static_cast<const unsigned char *>(mapped);
+    mappedSize = static_cast<size_t>(status.st_size);
+    entryCount = mappedSize / ENTRY_SIZE;
+    return true;
+}
+
+void OpeningBook::close() {
+    if(entries != nullptr)
+        munmap(const_cast<unsigned char *>(entries), mappedSize);
+    entries = nullptr;
+    entryCount = 0;
+    mappedSize = 0;
+}
+
+uint64_t OpeningBook::keyAt(size_t index) const {
+    return readBigEndian(entries + index * ENTRY_SIZE, 8);
+}
+
+bool OpeningBook::probe(Board &board, vector<BookMove> &moves) const {
+    moves.clear();
+    if(!isOpen())
+        return false;
+
+    // Binary search for the first entry of the key, the entries of a position are next to each other
+    uint64_t key = board.getHashKey();
+    size_t low = 0, high = entryCount;
+    while(low < high) {
+        size_t middle = low + (high - low) / 2;
+        if(keyAt(middle) < key)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    for(size_t index = low; index < entryCount && keyAt(index) == key; ++index) {
+        const unsigned char *entry = entries + index * ENTRY_SIZE;
+        Move move = decodeMove(static_cast<uint16_t>(readBigEndian(entry + 8, 2)));
+        int weight = static_cast<int>(readBigEndian(entry + 10, 2));
+
+        // Two positions can have the same key, a move that isn't legal here belongs to the other one
+        if(weight == 0 || !board.isPseudoLegal(move) || !board.isLegal(move))
+            continue;
+        moves.push_back({ move, weight });
+    }
+    return !moves.empty();
+}
+
+bool OpeningBook::pickMove(Board &board, Move &move) {
+    vector<BookMove> moves;
+    if(!probe(board, moves))
+        return false;
+
+    int totalWeight = 0;
+    for(const BookMove &bookMove : moves)
+        totalWeight += bookMove.weight;
+
+    int pick = std::uniform_int_distribution<int>(0, totalWeight - 1)(random);
+    for(const BookMove &bookMove : moves) {
+        pick -= bookMove.weight;
+        if(pick < 0) {
+            move = bookMove.move;
+            return true;
+        }
+    }
+    move = moves.back().move;
+    return true;
+}
+
+uint16_t OpeningBook::encodeMove(const Move &move) {
+    int promotion = 0;
+    for(int i=1; i<5; ++i) {
+        if(promotionTypes[i] == move.promotion)
+            promotion = i;
+    }
+    // Book ranks count from rank 1, rows count from rank 8
+    return static_cast<uint16_t>(colOf(move.to) | ((7 - rowOf(move.to)) << 3) | (colOf(move.from) << 6)
+                                 | ((7 - rowOf(move.from)) << 9) | (promotion << 12));
+}
+
+Move OpeningBook::decodeMove(uint16_t code) {
+    Move move;
+    move.to = static_cast<uint8_t>(toSquare(7 - ((code >> 3) & 7), code & 7));
+    move.from = static_cast<uint8_t>(toSquare(7 - ((code >> 9) & 7), (code >> 6) & 7));
+    int promotion = (code >> 12) & 7;
+    move.promotion = promotion < 5 ? promotionTypes[promotion] : PieceType::Empty;
+    return move;
+}
+
+void OpeningBook::writeEntry(unsigned char *entry, uint64_t key, uint16_t move, uint16_t weight) {
+    writeBigEndian(entry, key, 8);
+    writeBigEndian(entry + 8, move, 2);
+    writeBigEndian(entry + 10, weight, 2);
+    writeBigEndian(entry + 12, 0, 4);
+}
@@ -0,0 +1,66 @@
+/* Opening book: moves played in known positions, found without searching.
+ * The book file is a list of 16-byte entries sorted by key, laid out like the entries of a Polyglot book:
+ *   key (8 bytes), move (2 bytes), weight (2 bytes), learn (4 bytes), every number big-endian.
+ * The key is the Zobrist key of the position (Board::getHashKey), not the Polyglot one, so Polyglot books can't be read.
+ * A move is to col in bits 0-2, to rank in bits 3-5, from col in bits 6-8, from rank in bits 9-11 (ranks count from
+ * rank 1 like in Polyglot) and the promotion in bits 12-14 (1 Knight, 2 Bishop, 3 Rook, 4 Queen). Castling is the King's
+ * two squares move. The more weight a move has, the more often it is picked.
+ *
+ * The file is mapped into memory, not read: opening it costs nothing however big it is, and a lookup is a binary search
+ * over the entries. build_book makes a book from games (see build_book.cpp). */
+
+#ifndef CHESS_OPENINGBOOK_H
+#define CHESS_OPENINGBOOK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include "Board.h"
+
+// A book move of a position and how often it should be picked
+struct BookMove {
+    Move move;
+    int weight;
+};
+
+class OpeningBook {
+public:
+    static const size_t ENTRY_SIZE = 16;
+
+    OpeningBook();
+    ~OpeningBook();
+
+    OpeningBook(const OpeningBook &) = delete;
+    OpeningBook &operator=(const OpeningBook &) = delete;
+
+    // Maps the book file into memory, a book opened before is closed. Returns false if the file can't be mapped or its
+    // size is not a whole number of entries.
+    bool open(const string &fileName);
+    void close();
+    bool isOpen() const { return entryCount > 0; }
+
+    // Fills the list with the legal book moves of the board's position, returns false if there are none
+    bool probe(Board &board, vector<BookMove> &moves) const;
+
+    // Picks one of the book moves of the position at random, the weights are the chances. Returns false if the
+    // position is not in the book.
+    bool pickMove(Board &board, Move &move);
+
+    // Packs a move into the 16 bits of a book entry and back
+    static uint16_t encodeMove(const Move &move);
+    static Move decodeMove(uint16_t code);
+
+    // Writes the 16 bytes of an entry the way the book file stores them
+    static void writeEntry(unsigned char *entry, uint64_t key, uint16_t move, uint16_t weight);
+
+private:
+    // Returns the key of the entry at the index
+    uint64_t keyAt(size_t index) const;
+
+    const unsigned char *entries;
+    size_t entryCount;
+    size_t mappedSize;
+    std::mt19937 random;
+};
+
+#endif //CHESS_OPENINGBOOK_H
@@ -1,19 +1,30 @@
 #include "Piece.h"
 
-Piece::Piece(PieceType typeVal, int colorVal, int hasMovedVal) : type(typeVal), color(colorVal), hasMoved(hasMovedVal) {
+const uint8_t Piece::TYPE_MASK;
+const uint8_t Piece::COLOR_BIT;
+const uint8_t Piece::MOVED_BIT;
+
+Piece::Piece(PieceType typeVal, int colorVal, int hasMovedVal)
+        : code(static_cast<uint8_t>(static_cast<int>(typeVal) | (colorVal ? COLOR_BIT : 0) | (hasMovedVal ? MOVED_BIT : 0))) {
     // Intentionally left blank
 }
 
+Piece Piece::fromCode(uint8_t code) {
+    Piece piece;
+    piece.code = code;
+    return piece;
+}
+
 PieceType Piece::getType() const {
-    return type;
+    return static_cast<PieceType>(code & TYPE_MASK);
 }
 
 int Piece::getColor() const {
-    return color;
+    return (code & COLOR_BIT) ? 1 : 0;
 }
 
 int Piece::gethasMoved() const {
-    return hasMoved;
+    return (code & MOVED_BIT) ? 1 : 0;
 }
 
 char Piece::getSymbol() const {
@@ -53,48 +64,23 @@ char Piece::getSymbol() const {
 }
 
 void Piece::setType(PieceType& newType) {
-    type = newType;
+    code = static_cast<uint8_t>((code & ~TYPE_MASK) | static_cast<int>(newType));
 }
 
 void Piece::setType(int newType) {
-    // Sets the piece type from an int value
-    switch (newType) {
-        case 0:
-            type = PieceType::Pawn;
-            break;
-        case 1:
-            type = PieceType::Rook;
-            break;
-        case 2:
-            type = PieceType::Knight;
-            break;
-        case 3:
-            type = PieceType::Bishop;
-            break;
-        case 4:
-            type = PieceType::Queen;
-            break;
-        case 5:
-            type = PieceType::King;
-            break;
-        case 6:
-            type = PieceType::Empty;
-            break;
-        default:
-            type = PieceType::Empty;
-    }
+    // Sets the piece type from an int value, values out of the PieceType range make an Empty piece
+    PieceType type = (newType >= 0 && newType <= 6) ? static_cast<PieceType>(newType) : PieceType::Empty;
+    setType(type);
 }
 
 void Piece::setColor(int newColor) {
-    color = newColor;
+    code = static_cast<uint8_t>(newColor ? (code | COLOR_BIT) : (code & ~COLOR_BIT));
 }
 
 void Piece::setMoved(int newStatus) {
-    hasMoved = newStatus;
+    code = static_cast<uint8_t>(newStatus ? (code | MOVED_BIT) : (code & ~MOVED_BIT));
 }
 
 void Piece::makeEmpty() {
-    hasMoved = 0;
-    color = 0;
-    type = PieceType::Empty;
+    code = static_cast<uint8_t>(PieceType::Empty);
 }
@@ -1,15 +1,24 @@
 #ifndef CHESS_PIECE_H
 #define CHESS_PIECE_H
 
+#include <cstdint>
+
 enum class PieceType {
     Pawn, Rook, Knight, Bishop, Queen, King, Empty
 };
 
+// A piece is stored in a single byte: the type in bits 0-2, the color in bit 3 and the moved flag in bit 4.
 class Piece {
 public:
     // Constructor with defaulted values for all private data members
     explicit Piece(PieceType type=PieceType::Empty, int color=0, int hasMoved=0);
 
+    // Returns the piece stored in the code, the other way around of getCode
+    static Piece fromCode(uint8_t code);
+
+    // Returns the byte the piece is stored in
+    uint8_t getCode() const { return code; }
+
     // Getters for the private data members
     PieceType getType() const;
     int getColor() const;
@@ -25,9 +34,11 @@ public:
     // Updates the private data members of a piece as a default (empty) cell all at once.
     void makeEmpty();
 private:
-    PieceType type;
-    int color; // Holds 0 for white and 1 for black pieces
-    int hasMoved; // Starts 0, turns into 1 when the piece is moved
+    static const uint8_t TYPE_MASK = 7;
+    static const uint8_t COLOR_BIT = 8;  // Set for black pieces, clear for white pieces
+    static const uint8_t MOVED_BIT = 16; // Clear at the start, set when the piece is moved
+
+    uint8_t code;
 };
 
 
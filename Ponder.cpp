@@ -0,0 +1,42 @@
+#include "Ponder.h"
+
+Ponder::Ponder(Search &search) : search(search), stopFlag(false) {
+    result.depth = 0;
+}
+
+Ponder::~Ponder() {
+    stop();
+}
+
+void Ponder::start(const Board &board) {
+    stop();
+
+    // No budget, only the flag (and MAX_DEPTH or a found mate) ends the search
+    SearchLimits limits;
+    limits.stop = &stopFlag;
+    stopFlag = false;
+    result.depth = 0;
+
+    Board position = board;
+    thread = std::thread([this, position, limits]() mutable {
+        result = search.think(position, limits);
+    });
+}
+
+bool Ponder::stop(SearchResult &pondered) {
+    if(!thread.joinable())
+        return false;
+
+    stopFlag = true;
+    thread.join();
+    if(result.depth == 0 || result.bestMove.from == result.bestMove.to)
+        return false;
+
+    pondered = result;
+    return true;
+}
+
+void Ponder::stop() {
+    SearchResult unused;
+    stop(unused);
+}
@@ -0,0 +1,37 @@
+/* Pondering: searching the position in the background while the program waits for the player's input, so the time the
+ * player spends thinking is not lost. The search runs on its own thread with no budget until it is stopped.
+ * When the input arrives the search is stopped: its results stay in the transposition table for the next searches
+ * (after a move too, the positions after it are in the searched tree), and a suggestion for the position it searched
+ * can be given right away with the best move found so far if the search went as deep or as long as a suggestion's
+ * search would. */
+
+#ifndef CHESS_PONDER_H
+#define CHESS_PONDER_H
+
+#include <atomic>
+#include <thread>
+#include "Board.h"
+#include "Search.h"
+
+class Ponder {
+public:
+    // The search is shared with the rest of the program, it must not be used by anyone else until stop is called
+    explicit Ponder(Search &search);
+    ~Ponder();
+
+    // Starts searching a copy of the board's position in the background, stops the search before it if it is still on
+    void start(const Board &board);
+
+    // Stops the background search and waits for its thread. Returns true and gives the result if a depth was fully
+    // searched, false if it wasn't or no search was running.
+    bool stop(SearchResult &result);
+    void stop();
+
+private:
+    Search &search;
+    std::thread thread;
+    std::atomic<bool> stopFlag;
+    SearchResult result;    // Written by the thread, read after it is joined
+};
+
+#endif //CHESS_PONDER_H
@@ -0,0 +1,498 @@
+#include "Search.h"
+#include <iomanip>
+#include "MovePicker.h"
+#include "Tablebase.h"
+
+namespace {
+    // Piece values of the quiescence search's delta pruning, indexed by PieceType
+    const int deltaValues[7] = { 100, 500, 320, 330, 900, 0, 0 };
+
+    // A capture is skipped if even winning this much more than the captured piece can't bring the score up to alpha
+    const int DELTA_MARGIN = 200;
+
+    // Score of an endgame table result for the side to move, with the mate counted from the root like the search's
+    int tablebaseScore(const TablebaseResult &result, int ply) {
+        if(result.wdl == WDL::Win)
+            return Search::MATE_SCORE - (ply + result.plies);
+        if(result.wdl == WDL::Loss)
+            return -Search::MATE_SCORE + (ply + result.plies);
+        return 0;
+    }
+
+    bool sameMove(const Move &a, const Move &b) {
+        return a.from == b.from && a.to == b.to && a.promotion == b.promotion;
+    }
+
+    // Mate scores count the plies from the root, but a stored position can be reached at any ply.
+    // The table keeps them as the plies from the stored position, and they are turned back when read.
+    int scoreToTable(int score, int ply) {
+        if(score > Search::MATE_SCORE - Search::MAX_MATE_PLIES)
+            return score + ply;
+        if(score < -Search::MATE_SCORE + Search::MAX_MATE_PLIES)
+            return score - ply;
+        return score;
+    }
+
+    int scoreFromTable(int score, int ply) {
+        if(score > Search::MATE_SCORE - Search::MAX_MATE_PLIES)
+            return score - ply;
+        if(score < -Search::MATE_SCORE + Search::MAX_MATE_PLIES)
+            return score + ply;
+        return score;
+    }
+}
+
+void SearchStats::clear() {
+    nodes = quiescenceNodes = 0;
+    tableProbes = tableHits = tableCutoffs = 0;
+    betaCutoffs = firstMoveCutoffs = 0;
+    movesMade = evaluations = 0;
+    seconds = 0;
+    iterations.clear();
+}
+
+double SearchStats::nodesPerSecond() const {
+    return seconds > 0 ? nodes / seconds : 0;
+}
+
+double SearchStats::tableHitRate() const {
+    return tableProbes > 0 ? 100.0 * tableHits / tableProbes : 0;
+}
+
+double SearchStats::tableCutoffRate() const {
+    return tableProbes > 0 ? 100.0 * tableCutoffs / tableProbes : 0;
+}
+
+double SearchStats::firstMoveCutoffRate() const {
+    return betaCutoffs > 0 ? 100.0 * firstMoveCutoffs / betaCutoffs : 0;
+}
+
+double SearchStats::branchingFactor() const {
+    size_t count = iterations.size();
+    if(count < 2)
+        return 0;
+
+    // The nodes are counted from the start of the search, each depth's own nodes are the difference
+    uint64_t last = iterations[count - 1].nodes - iterations[count - 2].nodes;
+    uint64_t previous = iterations[count - 2].nodes - (count >= 3 ? iterations[count - 3].nodes : 0);
+    return previous > 0 ? static_cast<double>(last) / previous : 0;
+}
+
+void SearchStats::print(std::ostream &output) const {
+    double quiescenceShare = nodes > 0 ? 100.0 * quiescenceNodes / nodes : 0;
+    std::ios_base::fmtflags flags = output.flags();
+    std::streamsize precision = output.precision();
+    output << std::fixed << std::setprecision(1);
+    output << "Search statistics:\n"
+           << "  " << nodes << " nodes (" << quiescenceShare << "% in quiescence) in " << std::setprecision(3) << seconds
+           << std::setprecision(1) << " s, "
+           << static_cast<uint64_t>(nodesPerSecond()) << " nodes/s\n"
+           << "  transposition table: " << tableProbes << " probes, " << tableHitRate() << "% hits, "
+           << tableCutoffRate() << "% cutoffs\n"
+           << "  " << betaCutoffs << " beta cutoffs, " << firstMoveCutoffRate() << "% by the first move\n"
+           << "  " << movesMade << " moves made, " << evaluations << " evaluations\n"
+           << "  branching factor " << branchingFactor() << "\n";
+    for(const SearchIterationStats &iteration : iterations)
+        output << "  depth " << iteration.depth << ": " << iteration.nodes << " nodes, " << std::setprecision(3)
+               << iteration.seconds << " s\n";
+    output.flags(flags);
+    output.precision(precision);
+}
+
+Search::Search() : stopped(false), threadCount(1), tablebases(nullptr), statsEnabled(false) {
+}
+
+int moveTimeFromClock(int time, int increment, int movesToGo) {
+    int share = time / (movesToGo > 0 ? movesToGo : 30) + increment * 3 / 4;
+    int safetyLimit = time - 50;
+    int moveTime = share < safetyLimit ? share : safetyLimit;
+    return moveTime < 1 ? 1 : moveTime;
+}
+
+bool Search::isMateScore(int score) {
+    return score > MATE_SCORE - MAX_MATE_PLIES || score < -MATE_SCORE + MAX_MATE_PLIES;
+}
+
+int Search::movesToMate(int score) {
+    // The score tells the plies to the mate, a move is a ply of each side
+    int plies = MATE_SCORE - (score > 0 ? score : -score);
+    int moves = (plies + 1) / 2;
+    return score > 0 ? moves : -moves;
+}
+
+uint64_t Search::totalNodes() const {
+    uint64_t total = 0;
+    for(const std::unique_ptr<Worker> &worker : workers)
+        total += worker->nodes.load(std::memory_order_relaxed);
+    return total;
+}
+
+bool Search::budgetUsedUp(Worker &worker) {
+    if(worker.id != 0)
+        return stopped.load(std::memory_order_relaxed);
+
+    uint64_t nodes = worker.nodes.load(std::memory_order_relaxed);
+
+    // Reading the clock (and the other threads' counters) is slow compared to a node, so it is only done every 1024 nodes
+    if((nodes & 1023) == 0) {
+        if(workers.size() > 1)
+            worker.otherNodes = totalNodes() - nodes;
+
+        if(limits.moveTime) {
+            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime);
+            if(elapsed.count() >= limits.moveTime)
+                stopped = true;
+        }
+
+        if(limits.stop && limits.stop->load(std::memory_order_relaxed))
+            stopped = true;
+    }
+
+    if(limits.nodes && nodes + worker.otherNodes >= limits.nodes)
+        stopped = true;
+
+    return stopped.load(std::memory_order_relaxed);
+}
+
+SearchResult Search::think(Board &board, const SearchLimits &searchLimits) {
+    limits = searchLimits;
+    startTime = std::chrono::steady_clock::now();
+    stopped = false;
+    stats.clear();
+
+    // A position of the endgame tables has its best move there, nothing to search
+    Move tablebaseMove;
+    TablebaseResult tablebaseResult;
+    if(tablebases != nullptr && tablebases->bestMove(board, tablebaseMove, tablebaseResult)) {
+        SearchResult result;
+        result.bestMove = tablebaseMove;
+        result.score = tablebaseScore(tablebaseResult, 0);
+        result.depth = 1;
+        result.nodes = 1;
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        if(statsEnabled) {
+            stats.nodes = result.nodes;
+            stats.seconds = result.seconds;
+        }
+        if(onIteration)
+            onIteration(result);
+        return result;
+    }
+
+    // Every thread gets its own copy of the position
+    workers.clear();
+    for(int i=0; i<threadCount; ++i) {
+        workers.push_back(std::unique_ptr<Worker>(new Worker()));
+        workers[i]->id = i;
+        workers[i]->board = board;
+        workers[i]->nodes = 0;
+        workers[i]->otherNodes = 0;
+        workers[i]->clearOrdering();
+        workers[i]->counters.clear();
+    }
+
+    // The other threads only help by filling the transposition table, the main thread's result is the search's result
+    std::vector<std::thread> helpers;
+    for(int i=1; i<threadCount; ++i)
+        helpers.push_back(std::thread(&Search::iterate, this, std::ref(*workers[i])));
+
+    iterate(*workers[0]);
+
+    stopped = true;
+    for(std::thread &helper : helpers)
+        helper.join();
+
+    SearchResult result = workers[0]->result;
+    result.nodes = totalNodes();
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    if(statsEnabled) {
+        collectStats();
+        stats.nodes = result.nodes;
+        stats.seconds = result.seconds;
+    }
+    return result;
+}
+
+void Search::collectStats() {
+    for(const std::unique_ptr<Worker> &worker : workers) {
+        const SearchStats &counters = worker->counters;
+        stats.quiescenceNodes += counters.quiescenceNodes;
+        stats.tableProbes += counters.tableProbes;
+        stats.tableHits += counters.tableHits;
+        stats.tableCutoffs += counters.tableCutoffs;
+        stats.betaCutoffs += counters.betaCutoffs;
+        stats.firstMoveCutoffs += counters.firstMoveCutoffs;
+        stats.movesMade += counters.movesMade;
+        stats.evaluations += counters.evaluations;
+    }
+}
+
+void Search::iterate(Worker &worker) {
+    Board &board = worker.board;
+    SearchResult &result = worker.result;
+    result.bestMove.from = result.bestMove.to = 0;
+    result.bestMove.promotion = PieceType::Empty;
+    result.score = 0;
+    result.depth = 0;
+
+    // Start with any legal move, so a move is returned even if the budget runs out before depth 1 is finished
+    MoveList moveList;
+    board.generateLegalMoves(board.getSideToMove(), moveList);
+    if(moveList.count > 0)
+        result.bestMove = moveList.moves[0];
+    worker.rootBestMove = result.bestMove;
+
+    // Half of the helper threads start one depth deeper, so the threads are not all searching the same depth
+    int firstDepth = 1 + (worker.id & 1);
+    int maxDepth = (limits.depth > 0 && limits.depth < MAX_DEPTH) ? limits.depth : MAX_DEPTH;
+    for(int depth=firstDepth; depth<=maxDepth; ++depth) {
+        int score = alphaBeta(worker, depth, 0, -INFINITE_SCORE, INFINITE_SCORE);
+
+        // A depth that was stopped before the end is not trusted, the last fully searched depth's move is kept
+        if(stopped)
+            break;
+
+        result.bestMove = worker.rootBestMove;
+        result.score = score;
+        result.depth = depth;
+
+        // Only the main thread writes the iterations, the other threads' depths are not the search's depths
+        if(worker.id == 0 && statsEnabled) {
+            SearchIterationStats iteration;
+            iteration.depth = depth;
+            iteration.nodes = totalNodes();
+            iteration.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+            stats.iterations.push_back(iteration);
+        }
+
+        if(worker.id == 0 && onIteration) {
+            SearchResult progress = result;
+            progress.nodes = totalNodes();
+            progress.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+            onIteration(progress);
+        }
+
+        // A forced mate can't be improved by searching deeper
+        if(isMateScore(score))
+            break;
+
+        // The next depth takes longer than all the depths before it together, don't start it if half the time is gone
+        if(limits.moveTime && worker.id == 0) {
+            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime);
+            if(elapsed.count() * 2 >= limits.moveTime)
+                break;
+        }
+    }
+}
+
+int Search::alphaBeta(Worker &worker, int depth, int ply, int alpha, int beta) {
+    if(budgetUsedUp(worker))
+        return 0;
+    worker.nodes.store(worker.nodes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    Board &board = worker.board;
+    int color = board.getSideToMove();
+    uint64_t key = board.getHashKey();
+    int originalAlpha = alpha;
+
+    // The endgame tables know the exact result (the root has to find a move, think looks it up there)
+    TablebaseResult tablebaseResult;
+    if(ply > 0 && tablebases != nullptr && tablebases->probe(board, tablebaseResult))
+        return tablebaseScore(tablebaseResult, ply);
+
+    // A result stored from a search at least as deep can be used instead of searching again (except at the root, which
+    // has to find the move). A stored bound is enough if it is outside of the alpha-beta window.
+    TTEntry entry;
+    bool found = table.probe(key, entry);
+    if(statsEnabled) {
+        ++worker.counters.tableProbes;
+        worker.counters.tableHits += found;
+    }
+    if(found && ply > 0 && entry.depth >= depth) {
+        int storedScore = scoreFromTable(entry.score, ply);
+        if(entry.bound == Bound::Exact
+           || (entry.bound == Bound::Lower && storedScore >= beta)
+           || (entry.bound == Bound::Upper && storedScore <= alpha)) {
+            if(statsEnabled)
+                ++worker.counters.tableCutoffs;
+            return storedScore;
+        }
+    }
+
+    if(depth == 0)
+        return quiescence(worker, ply, alpha, beta);
+
+    // Search the best move of the previous iteration (at the root) or of the stored result first, it gives the best
+    // bound for the other moves. The picker checks that it is possible here, a different position may share the key.
+    Move hashMove = { 0, 0, PieceType::Empty };
+    if(ply == 0)
+        hashMove = worker.rootBestMove;
+    else if(found)
+        hashMove = entry.move;
+
+    MovePicker picker(board, hashMove, worker.killers[ply], worker.history[color]);
+    Move move;
+
+    int bestScore = -INFINITE_SCORE;
+    Move bestMove = hashMove;
+    int legalMoves = 0;
+
+    while(picker.next(move)) {
+        bool quiet = move.promotion == PieceType::Empty && !board.isCapture(move);
+
+        // The picker gives only legal moves, none has to be taken back for leaving the King under attack
+        board.makeMove(move);
+        if(statsEnabled)
+            ++worker.counters.movesMade;
+        ++legalMoves;
+
+        int score = -alphaBeta(worker, depth - 1, ply + 1, -beta, -alpha);
+        board.unmakeMove();
+
+        if(stopped)
+            return 0;
+
+        if(score > bestScore) {
+            bestScore = score;
+            if(score > alpha) {
+                alpha = score;
+                bestMove = move;
+                if(ply == 0)
+                    worker.rootBestMove = move;
+                // The opponent already has a better option earlier in the tree, no need to look at the other moves
+                if(alpha >= beta) {
+                    if(statsEnabled) {
+                        ++worker.counters.betaCutoffs;
+                        worker.counters.firstMoveCutoffs += legalMoves == 1;
+                    }
+                    // A quiet move that refutes the opponent's move is likely to refute it in other positions at the
+                    // same ply too (killer), and a move that cuts deeper trees is worth trying earlier (history)
+                    if(quiet) {
+                        if(!sameMove(move, worker.killers[ply][0])) {
+                            worker.killers[ply][1] = worker.killers[ply][0];
+                            worker.killers[ply][0] = move;
+                        }
+                        int &historyScore = worker.history[color][move.from][move.to];
+                        historyScore += depth * depth;
+                        // A search with no budget (pondering) would overflow the scores in the end. Halving them all
+                        // keeps their order, and the older cutoffs count less than the new ones.
+                        if(historyScore > MAX_HISTORY_SCORE) {
+                            for(int from=0; from<64; ++from) {
+                                for(int to=0; to<64; ++to)
+                                    worker.history[color][from][to] /= 2;
+                            }
+                        }
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+    // No legal moves: checkmate if the King is attacked (sooner mates score higher), otherwise stalemate.
+    // That is true at any depth, so it is stored as the deepest possible result.
+    if(legalMoves == 0) {
+        int score = board.isKingSafe(color) == 0 ? -MATE_SCORE + ply : 0;
+        Move noMove = { 0, 0, PieceType::Empty };
+        table.store(key, MAX_DEPTH, Bound::Exact, scoreToTable(score, ply), noMove);
+        return score;
+    }
+
+    Bound bound = bestScore >= beta ? Bound::Lower : (bestScore > originalAlpha ? Bound::Exact : Bound::Upper);
+    table.store(key, depth, bound, scoreToTable(bestScore, ply), bestMove);
+
+    return bestScore;
+}
+
+int Search::quiescence(Worker &worker, int ply, int alpha, int beta) {
+    if(budgetUsedUp(worker))
+        return 0;
+    worker.nodes.store(worker.nodes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if(statsEnabled)
+        ++worker.counters.quiescenceNodes;
+
+    Board &board = worker.board;
+    int color = board.getSideToMove();
+
+    // Mate scores only go down to MAX_DEPTH plies, a line of captures that long is evaluated where it is
+    if(ply >= MAX_DEPTH) {
+        if(statsEnabled)
+            ++worker.counters.evaluations;
+        return board.evaluate(color);
+    }
+
+    // In check there is no standing pat, every move is searched to find the ones that get out of it
+    bool inCheck = board.isKingSafe(color) == 0;
+    int standPat = -INFINITE_SCORE;
+    if(!inCheck) {
+        if(statsEnabled)
+            ++worker.counters.evaluations;
+        standPat = board.evaluate(color);
+        // Not capturing is already good enough for a cutoff, captures can only make it better
+        if(standPat >= beta)
+            return standPat;
+        if(standPat > alpha)
+            alpha = standPat;
+    }
+
+    Move noMove = { 0, 0, PieceType::Empty };
+    Move noKillers[2] = { noMove, noMove };
+    MovePicker picker = inCheck ? MovePicker(board, noMove, noKillers, worker.history[color]) : MovePicker(board);
+    Move move;
+
+    int bestScore = standPat;
+    int legalMoves = 0;
+
+    while(picker.next(move)) {
+        // Delta pruning: a capture that doesn't reach alpha even with the captured piece's value and a margin on top
+        // is not worth searching (promotions add the new piece's value)
+        if(!inCheck) {
+            PieceType victim = board.getPiece(rowOf(move.to), colOf(move.to)).getType();
+            int gain = deltaValues[static_cast<int>(victim)];
+            // En passant takes a pawn that is not on the move's square
+            if(victim == PieceType::Empty && board.isCapture(move))
+                gain = deltaValues[static_cast<int>(PieceType::Pawn)];
+            if(move.promotion != PieceType::Empty)
+                gain += deltaValues[static_cast<int>(move.promotion)] - deltaValues[static_cast<int>(PieceType::Pawn)];
+            if(standPat + gain + DELTA_MARGIN <= alpha)
+                continue;
+        }
+
+        board.makeMove(move);
+        if(statsEnabled)
+            ++worker.counters.movesMade;
+        ++legalMoves;
+
+        int score = -quiescence(worker, ply + 1, -beta, -alpha);
+        board.unmakeMove();
+
+        if(stopped)
+            return 0;
+
+        if(score > bestScore) {
+            bestScore = score;
+            if(score > alpha) {
+                alpha = score;
+                if(alpha >= beta)
+                    break;
+            }
+        }
+    }
+
+    // In check with no legal move is checkmate (without the check, having no capture is not the end of the game)
+    if(inCheck && legalMoves == 0)
+        return -MATE_SCORE + ply;
+
+    return bestScore;
+}
+
+void Search::Worker::clearOrdering() {
+    Move noMove = { 0, 0, PieceType::Empty };
+    for(int ply=0; ply<MAX_DEPTH; ++ply)
+        killers[ply][0] = killers[ply][1] = noMove;
+
+    for(int color=0; color<2; ++color)
+        for(int from=0; from<64; ++from)
+            for(int to=0; to<64; ++to)
+                history[color][from][to] = 0;
+}
@@ -0,0 +1,207 @@
+/* Move search used by the suggestMove function.
+ * Negamax alpha-beta search with iterative deepening: the position is searched to depth 1, 2, 3... until the time or
+ * node budget runs out, and the best move of the last fully searched depth is returned. The positions at the end of
+ * the main search are searched further with captures only (quiescence search) before they are evaluated.
+ * Results are kept in a transposition table between the depths and between the searches.
+ *
+ * The search can use several threads (Lazy SMP): every thread searches the same position on its own copy of the board,
+ * and they share only the transposition table. Results one thread stores cut the trees of the others, so together they
+ * reach a depth sooner. The main thread decides when to stop and its result is the result of the search.
+ *
+ * If endgame tables are given (see Tablebase.h), positions with few enough pieces take their exact result from them
+ * instead of being searched. */
+
+#ifndef CHESS_SEARCH_H
+#define CHESS_SEARCH_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <thread>
+#include <vector>
+#include "Board.h"
+#include "TranspositionTable.h"
+
+class Tablebases;
+
+// Budget of a search. A value of 0 means no limit of that kind (the depth is still capped at Search::MAX_DEPTH).
+struct SearchLimits {
+    int depth;
+    int moveTime;   // In milliseconds
+    uint64_t nodes;
+    // If given, the search stops as soon as another thread sets the flag to true (checked every 1024 nodes)
+    const std::atomic<bool> *stop;
+
+    SearchLimits() : depth(0), moveTime(0), nodes(0), stop(nullptr) {}
+};
+
+// Returns the milliseconds to spend on a move with time milliseconds left on the clock: an equal share of the time for
+// each move still to play (30 if movesToGo is 0, not known), plus most of the increment, always keeping a little time
+// for the moves after this one. At least 1.
+int moveTimeFromClock(int time, int increment, int movesToGo);
+
+// Outcome of a search
+struct SearchResult {
+    Move bestMove;  // promotion is PieceType::Empty and from == to if the side to move has no legal move
+    int score;      // In centipawns from the side to move's view, see Search::isMateScore
+    int depth;      // Last fully searched depth, 0 if not even depth 1 was finished
+    uint64_t nodes;
+    double seconds;
+};
+
+// Nodes and time of one depth of the iterative deepening
+struct SearchIterationStats {
+    int depth;
+    uint64_t nodes;     // Nodes of all the threads since the start of the search, when the depth was finished
+    double seconds;     // Time since the start of the search
+};
+
+// What a search did, to tell why it was fast or slow. Filled only if Search::setStatsEnabled(true) was called, counts
+// are totals of all the threads.
+struct SearchStats {
+    uint64_t nodes;
+    uint64_t quiescenceNodes;   // Part of the nodes searched by the quiescence search
+    uint64_t tableProbes;       // Transposition table lookups of the main search
+    uint64_t tableHits;         // Lookups that found the position
+    uint64_t tableCutoffs;      // Hits whose stored result was used instead of searching
+    uint64_t betaCutoffs;       // Main search nodes where a move was good enough to stop looking at the others
+    uint64_t firstMoveCutoffs;  // Beta cutoffs by the first legal move, a sign of good move ordering
+    uint64_t movesMade;         // Moves made (and taken back) by the search, all legal (see Board::generateLegalMoves)
+    uint64_t evaluations;       // Calls of Board::evaluate (two calculateScore calls each)
+    double seconds;
+    vector<SearchIterationStats> iterations;
+
+    SearchStats() { clear(); }
+    void clear();
+
+    double nodesPerSecond() const;
+    // Percentages, 0 when there is nothing to divide by
+    double tableHitRate() const;
+    double tableCutoffRate() const;
+    double firstMoveCutoffRate() const;
+    // Effective branching factor: how many times more nodes the last depth took than the one before it, 0 if fewer than
+    // two depths were searched
+    double branchingFactor() const;
+
+    // Writes the statistics as a few readable lines
+    void print(std::ostream &output) const;
+};
+
+class Search {
+public:
+    static const int MAX_DEPTH = 64;
+    static const int INFINITE_SCORE = 32000;
+    // Score of a position where the side to move is checkmated, mates further away score a little less
+    static const int MATE_SCORE = 31000;
+    // Mates found by the search are at most MAX_DEPTH plies away, the ones of the endgame tables can be further
+    static const int MAX_MATE_PLIES = 512;
+
+    Search();
+
+    // Searches the board's position for the side to move within the limits. The board is given back unchanged.
+    SearchResult think(Board &board, const SearchLimits &limits);
+
+    // Sets a function that is called with the result so far every time a depth is fully searched (from the thread
+    // that called think), for example to print the progress. An empty function turns it off.
+    void setIterationCallback(const std::function<void(const SearchResult &)> &callback) { onIteration = callback; }
+
+    // Sets how many threads search together (at least 1), the calling thread is one of them
+    void setThreads(int count) { threadCount = count < 1 ? 1 : count; }
+    int getThreads() const { return threadCount; }
+
+    // Returns true if the score means a forced checkmate (for either side)
+    static bool isMateScore(int score);
+
+    // Precondition: isMateScore(score). Returns in how many moves the side to move mates, negative if it gets mated.
+    static int movesToMate(int score);
+
+    // Changes the size of the transposition table in megabytes, the stored results are lost
+    void setHashSize(int megabytes) { table.resize(megabytes); }
+
+    // Forgets the results of the earlier searches
+    void clearHash() { table.clear(); }
+
+    // Returns the transposition table, so other functions (like Board::isCheckmate) can use the stored results
+    TranspositionTable &getTable() { return table; }
+
+    // Turns the statistics of the searches on or off (off by default). When off, counting costs a not taken branch.
+    void setStatsEnabled(bool enabled) { statsEnabled = enabled; }
+    bool getStatsEnabled() const { return statsEnabled; }
+
+    // Returns the statistics of the last search, empty if they were off
+    const SearchStats &getStats() const { return stats; }
+
+    // Sets the endgame tables the search looks positions up in, nullptr for none. They are not copied.
+    void setTablebases(const Tablebases *endgameTables) { tablebases = endgameTables; }
+
+private:
+    // Highest history score before the scores are halved, far from the int limit even with the largest bonus
+    // (MAX_DEPTH * MAX_DEPTH) added to it
+    static const int MAX_HISTORY_SCORE = 1 << 20;
+
+    // What one thread needs for its search, the threads share nothing else but the transposition table
+    struct Worker {
+        int id;          // 0 for the main thread
+        Board board;     // Own copy of the position, so the threads make and unmake moves independently
+        // Only the worker's own thread changes it, the main thread reads it to find the total
+        std::atomic<uint64_t> nodes;
+        // Nodes of the other workers, counted by the main thread every 1024 nodes for the node budget
+        uint64_t otherNodes;
+        // Best move of the root position found in the current iteration
+        Move rootBestMove;
+        SearchResult result;
+
+        // Move ordering (see MovePicker.h): two killer moves for each ply, and a history score for each color, from
+        // square and to square. A color's scores are halved when one of them gets above MAX_HISTORY_SCORE.
+        Move killers[MAX_DEPTH][2];
+        int history[2][64][64];
+
+        // Forgets the killers and the history scores of the previous search
+        void clearOrdering();
+
+        // Counts of the statistics, only changed if they are on. Plain numbers, each thread has its own.
+        SearchStats counters;
+    };
+
+    // Adds the counters of every worker to stats
+    void collectStats();
+
+    // Iterative deepening loop of one worker, fills the worker's result
+    void iterate(Worker &worker);
+
+    // Returns the score of the position for the side to move, searching depth more plies.
+    // ply is the distance from the root of the search.
+    int alphaBeta(Worker &worker, int depth, int ply, int alpha, int beta);
+
+    // Returns the score of the position at the end of the main search: only captures and promotions are searched until
+    // the position is quiet, so the evaluation is not taken in the middle of an exchange. The side to move can also
+    // stop capturing (stand pat) and take the evaluation of the position. When in check, every move is searched.
+    int quiescence(Worker &worker, int ply, int alpha, int beta);
+
+    // Returns true once the search has to stop. The main thread checks the time and node budget and tells the others
+    // to stop, the other threads only see that it did.
+    bool budgetUsedUp(Worker &worker);
+
+    // Returns the nodes searched by all the workers
+    uint64_t totalNodes() const;
+
+    SearchLimits limits;
+    std::chrono::steady_clock::time_point startTime;
+    std::atomic<bool> stopped;
+    int threadCount;
+    std::vector<std::unique_ptr<Worker> > workers;
+
+    std::function<void(const SearchResult &)> onIteration;
+
+    // Shared by all the threads
+    TranspositionTable table;
+    const Tablebases *tablebases;
+
+    bool statsEnabled;
+    SearchStats stats;
+};
+
+#endif //CHESS_SEARCH_H
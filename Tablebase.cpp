@@ -0,0 +1,764 @@
+#include "Tablebase.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <dirent.h>
+
+namespace {
+    /* One-byte entries of the tables, from the side to move's view:
+     *   0         draw
+     *   1 - 126   win, mates in (2 * entry - 1) plies
+     *   128 - 252 loss, gets mated in (2 * (entry - 128)) plies, 128 is checkmated
+     *   255       the position can't happen (pieces on the same square, the side not to move is in check...)
+     * Only the generator uses UNRESOLVED (a position without a result yet, the ones left at the end are draws) and
+     * NO_EXIT (a position without captures or promotions). */
+    const uint8_t DRAW = 0;
+    const uint8_t NO_EXIT = 253;
+    const uint8_t UNRESOLVED = 254;
+    const uint8_t ILLEGAL = 255;
+
+    inline bool isWin(int entry) { return entry >= 1 && entry <= 126; }
+    inline bool isLoss(int entry) { return entry >= 128 && entry <= 252; }
+    inline int pliesOf(int entry) { return isWin(entry) ? 2 * entry - 1 : isLoss(entry) ? 2 * (entry - 128) : 0; }
+    inline uint8_t winEntry(int plies) { return static_cast<uint8_t>(std::min((plies + 1) / 2, 126)); }
+    inline uint8_t lossEntry(int plies) { return static_cast<uint8_t>(128 + std::min(plies / 2, 124)); }
+
+    // Entry of a move's result from the moving side's view, given the entry of the position it reaches
+    inline uint8_t fromChild(int entry) {
+        if(isLoss(entry))
+            return winEntry(pliesOf(entry) + 1);
+        if(isWin(entry))
+            return lossEntry(pliesOf(entry) + 1);
+        return entry == UNRESOLVED ? UNRESOLVED : DRAW;
+    }
+
+    // Higher is better for the side to move: short wins, long wins, draws, long losses, short losses
+    inline int rankOf(int entry) {
+        if(isWin(entry))
+            return 1000 - pliesOf(entry);
+        if(isLoss(entry))
+            return -1000 + pliesOf(entry);
+        return 0;
+    }
+
+    // Pieces other than the Kings in the order of the tables, and their value to find the stronger side
+    const string pieceLetters = "QRBNP";
+    const int letterValues[5] = { 9, 5, 3, 3, 1 };
+    const PieceType letterTypes[5] = { PieceType::Queen, PieceType::Rook, PieceType::Bishop, PieceType::Knight,
+                                       PieceType::Pawn };
+
+    int letterIndex(PieceType type) {
+        for(int i=0; i<5; ++i) {
+            if(letterTypes[i] == type)
+                return i;
+        }
+        return -1;
+    }
+
+    // Returns true if the letters (sorted in table order) are stronger than the others, or as strong and first in order
+    bool isStronger(const string &letters, const string &others) {
+        int value = 0, otherValue = 0;
+        for(char c : letters) value += letterValues[pieceLetters.find(c)];
+        for(char c : others) otherValue += letterValues[pieceLetters.find(c)];
+        if(value != otherValue)
+            return value > otherValue;
+
+        // Sorted letters compare by their order: a Queen is before everything else
+        for(size_t i=0; i<letters.size() && i<others.size(); ++i) {
+            if(letters[i] != others[i])
+                return pieceLetters.find(letters[i]) < pieceLetters.find(others[i]);
+        }
+        return letters.size() >= others.size();
+    }
+
+    void sortLetters(string &letters) {
+        std::sort(letters.begin(), letters.end(), [](char a, char b) {
+            return pieceLetters.find(a) < pieceLetters.find(b);
+        });
+    }
+
+    // Reads a name like "KQvKR" or "KQKR" into the letters of each side, returns false if it isn't one
+    bool parseName(const string &name, string &white, string &black) {
+        string text;
+        for(char c : name) {
+            if(c != 'v')
+                text += static_cast<char>(toupper(static_cast<unsigned char>(c)));
+        }
+        size_t secondKing = text.find('K', 1);
+        if(text.empty() || text[0] != 'K' || secondKing == string::npos)
+            return false;
+
+        white = text.substr(1, secondKing - 1);
+        black = text.substr(secondKing + 1);
+        for(char c : white + black) {
+            if(pieceLetters.find(c) == string::npos)
+                return false;
+        }
+        sortLetters(white);
+        sortLetters(black);
+        return true;
+    }
+
+    // A position of a table's pieces, the ones at index 0 and 1 are the white and the black King.
+    // A captured piece has the square -1.
+    struct Position {
+        int count;
+        PieceType type[Tablebases::MAX_MEN];
+        int color[Tablebases::MAX_MEN];
+        int square[Tablebases::MAX_MEN];
+        int side;
+        Bitboard byColor[2];
+
+        void updateOccupancy() {
+            byColor[0] = byColor[1] = 0;
+            for(int i=0; i<count; ++i) {
+                if(square[i] >= 0)
+                    byColor[color[i]] |= squareBit(square[i]);
+            }
+        }
+
+        Bitboard occupied() const { return byColor[0] | byColor[1]; }
+    };
+
+    Bitboard attacksOf(PieceType type, int color, int square, Bitboard occupied) {
+        switch(type) {
+            case PieceType::Pawn: return pawnAttacks(color, square);
+            case PieceType::Knight: return knightAttacks(square);
+            case PieceType::Bishop: return bishopAttacks(square, occupied);
+            case PieceType::Rook: return rookAttacks(square, occupied);
+            case PieceType::Queen: return bishopAttacks(square, occupied) | rookAttacks(square, occupied);
+            case PieceType::King: return kingAttacks(square);
+            default: return 0;
+        }
+    }
+
+    // Returns true if a piece of the color attacks the square
+    bool isAttacked(const Position &position, int square, int color) {
+        Bitboard occupied = position.occupied();
+        for(int i=0; i<position.count; ++i) {
+            if(position.color[i] == color && position.square[i] >= 0
+               && (attacksOf(position.type[i], color, position.square[i], occupied) & squareBit(square)))
+                return true;
+        }
+        return false;
+    }
+
+    // Calls visit(child, captured, promotion) for every legal move of the side to move. The child is the position after
+    // the move, captured is the index of the captured piece (-1 if none) and promotion the new type of a promoted pawn.
+    template<typename Visit>
+    void forEachLegalMove(const Position &position, Visit visit) {
+        int side = position.side;
+        int opponent = 1 - side;
+        Bitboard occupied = position.occupied();
+
+        for(int i=0; i<position.count; ++i) {
+            if(position.color[i] != side || position.square[i] < 0)
+                continue;
+
+            int from = position.square[i];
+            Bitboard targets;
+            if(position.type[i] == PieceType::Pawn) {
+                // White pawns move to the lower rows, black pawns to the higher ones
+                int forward = side == 0 ? -8 : 8;
+                int startRow = side == 0 ? 6 : 1;
+                targets = pawnAttacks(side, from) & position.byColor[opponent];
+                if(!(occupied & squareBit(from + forward))) {
+                    targets |= squareBit(from + forward);
+                    if(rowOf(from) == startRow && !(occupied & squareBit(from + 2 * forward)))
+                        targets |= squareBit(from + 2 * forward);
+                }
+            } else {
+                targets = attacksOf(position.type[i], side, from, occupied) & ~position.byColor[side];
+            }
+
+            while(targets) {
+                int to = popLowestSquare(targets);
+                Position child = position;
+                int captured = -1;
+                for(int j=0; j<position.count; ++j) {
+                    if(position.square[j] == to)
+                        captured = j;
+                }
+                // The King can't be taken in a legal position
+                if(captured >= 0 && position.type[captured] == PieceType::King)
+                    continue;
+
+                if(captured >= 0)
+                    child.square[captured] = -1;
+                child.square[i] = to;
+                child.updateOccupancy();
+                if(isAttacked(child, child.square[side], opponent))
+                    continue;
+                child.side = opponent;
+
+                bool promotion = position.type[i] == PieceType::Pawn && (rowOf(to) == 0 || rowOf(to) == 7);
+                if(!promotion) {
+                    visit(child, captured, PieceType::Empty);
+                    continue;
+                }
+                for(int p=0; p<4; ++p) {
+                    child.type[i] = letterTypes[p];
+                    visit(child, captured, letterTypes[p]);
+                }
+            }
+        }
+    }
+
+    // Runs work(begin, end) over the indexes from 0 to count in chunks shared out to the threads
+    template<typename Work>
+    void parallelFor(uint64_t count, int threads, Work work) {
+        const uint64_t CHUNK = 1 << 14;
+        std::atomic<uint64_t> next(0);
+        auto run = [&]() {
+            for(;;) {
+                uint64_t begin = next.fetch_add(CHUNK);
+                if(begin >= count)
+                    break;
+                work(begin, std::min(begin + CHUNK, count));
+            }
+        };
+
+        vector<std::thread> helpers;
+        for(int i=1; i<threads; ++i)
+            helpers.emplace_back(run);
+        run();
+        for(std::thread &helper : helpers)
+            helper.join();
+    }
+
+    void writeNumber(string &bytes, uint64_t value, int count) {
+        for(int i=0; i<count; ++i)
+            bytes += static_cast<char>((value >> (i * 8)) & 0xFF);
+    }
+
+    uint64_t readNumber(const string &bytes, size_t position, int count) {
+        uint64_t value = 0;
+        for(int i=0; i<count; ++i)
+            value |= static_cast<uint64_t>(static_cast<unsigned char>(bytes[position + i])) << (i * 8);
+        return value;
+    }
+
+    const string FILE_MAGIC = "NSTB";
+    const int FILE_VERSION = 1;
+    // In a file, this byte starts a run of the same entry: the entry and the length of the run follow
+    const uint8_t FILE_RUN = 254;
+
+    // Returns the smallest index of the position turned by the symmetries of the board. The positions of a symmetry
+    // group have the same result, so a file only keeps the entry of the smallest index. Without pawns the board can
+    // be mirrored, flipped and turned around its diagonal (8 symmetries), with pawns only mirrored (2 symmetries).
+    uint64_t canonicalIndex(uint64_t index, int count, bool pawns) {
+        int squares[Tablebases::MAX_MEN];
+        for(int i=count - 1; i>=0; --i) {
+            squares[i] = static_cast<int>(index & 63);
+            index >>= 6;
+        }
+        uint64_t side = index;
+
+        uint64_t smallest = UINT64_MAX;
+        for(int symmetry=0; symmetry < (pawns ? 2 : 8); ++symmetry) {
+            uint64_t turned = side;
+            for(int i=0; i<count; ++i) {
+                int square = squares[i];
+                if(symmetry & 4)
+                    square = (colOf(square) << 3) | rowOf(square);
+                square ^= (symmetry & 1 ? 7 : 0) ^ (symmetry & 2 ? 56 : 0);
+                turned = (turned << 6) | static_cast<uint64_t>(square);
+            }
+            smallest = std::min(smallest, turned);
+        }
+        return smallest;
+    }
+}
+
+Tablebases::Tablebases() : maxMen(0) {
+    initBitboards();
+}
+
+vector<string> Tablebases::getNames() const {
+    vector<string> names;
+    for(const std::pair<const string, vector<uint8_t> > &table : tables)
+        names.push_back(table.first);
+    return names;
+}
+
+int Tablebases::probeMen(Man *men, int count, int side) const {
+    // Letters of each side's pieces other than the King, there has to be one King of each color
+    string letters[2];
+    int kings[2] = { 0, 0 };
+    for(int i=0; i<count; ++i) {
+        if(men[i].type == PieceType::King)
+            ++kings[men[i].color];
+        else
+            letters[men[i].color] += pieceLetters[letterIndex(men[i].type)];
+    }
+    if(kings[0] != 1 || kings[1] != 1)
+        return -1;
+    if(letters[0].empty() && letters[1].empty())
+        return DRAW;
+    sortLetters(letters[0]);
+    sortLetters(letters[1]);
+
+    // The stronger side is white in the tables, otherwise the colors and the rows are turned around
+    bool flip = !isStronger(letters[0], letters[1]);
+    int white = flip ? 1 : 0;
+    auto table = tables.find("K" + letters[white] + "vK" + letters[1 - white]);
+    if(table == tables.end())
+        return -1;
+
+    // Index of the position: side to move, then the squares of the Kings, the white pieces and the black pieces in the
+    // order of their letters, 6 bits each
+    uint64_t index = flip ? 1 - side : side;
+    for(int tableColor=0; tableColor<2; ++tableColor) {
+        for(int i=0; i<count; ++i) {
+            if(men[i].type == PieceType::King && (men[i].color != white) == (tableColor == 1))
+                index = (index << 6) | static_cast<uint64_t>(flip ? men[i].square ^ 56 : men[i].square);
+        }
+    }
+    for(int tableColor=0; tableColor<2; ++tableColor) {
+        for(int letter=0; letter<5; ++letter) {
+            for(int i=0; i<count; ++i) {
+                if(men[i].type == letterTypes[letter] && (men[i].color != white) == (tableColor == 1))
+                    index = (index << 6) | static_cast<uint64_t>(flip ? men[i].square ^ 56 : men[i].square);
+            }
+        }
+    }
+    return table->second[index];
+}
+
+bool Tablebases::probe(const Board &board, TablebaseResult &result) const {
+    int count = board.getPieceCount(0) + board.getPieceCount(1);
+    if(count > maxMen || board.castlingRights() != 0)
+        return false;
+
+    Man men[MAX_MEN];
+    int index = 0;
+    int side = board.getSideToMove();
+    for(int color=0; color<2; ++color) {
+        for(int i=0; i<board.getPieceCount(color); ++i) {
+            int square = board.getPieceSquare(color, i);
+            men[index++] = { board.getPiece(rowOf(square), colOf(square)).getType(), color, square };
+        }
+    }
+
+    // The tables don't know en passant, a position where it is possible is searched
+    int enPassant = board.getEnPassantSquare();
+    for(int i=0; i<count && enPassant >= 0; ++i) {
+        if(men[i].type == PieceType::Pawn && men[i].color == side && (pawnAttacks(side, men[i].square) & squareBit(enPassant)))
+            return false;
+    }
+
+    int entry = probeMen(men, count, side);
+    if(entry < 0 || entry == ILLEGAL)
+        return false;
+
+    result.wdl = isWin(entry) ? WDL::Win : isLoss(entry) ? WDL::Loss : WDL::Draw;
+    result.plies = pliesOf(entry);
+    return true;
+}
+
+bool Tablebases::bestMove(Board &board, Move &move, TablebaseResult &result) const {
+    TablebaseResult rootResult;
+    if(!probe(board, rootResult))
+        return false;
+
+    int color = board.getSideToMove();
+    MoveList moveList;
+    board.generateLegalMoves(color, moveList);
+
+    int bestRank = -INT_MAX;
+    for(int i=0; i<moveList.count; ++i) {
+        board.makeMove(moveList.moves[i]);
+        TablebaseResult childResult;
+        bool found = probe(board, childResult);
+        board.unmakeMove();
+        if(!found)
+            continue;
+
+        // The child's result is from the opponent's view
+        int rank = childResult.wdl == WDL::Loss ? 1000 - (childResult.plies + 1)
+                   : childResult.wdl == WDL::Win ? -1000 + (childResult.plies + 1) : 0;
+        if(rank > bestRank) {
+            bestRank = rank;
+            move = moveList.moves[i];
+        }
+    }
+    if(bestRank == -INT_MAX)
+        return false;
+
+    result = rootResult;
+    return true;
+}
+
+bool Tablebases::generate(const string &name, int threads, std::ostream *log) {
+    string letters[2];
+    if(!parseName(name, letters[0], letters[1]) || 2 + letters[0].size() + letters[1].size() > MAX_MEN)
+        return false;
+    if(!isStronger(letters[0], letters[1]))
+        std::swap(letters[0], letters[1]);
+    string canonical = "K" + letters[0] + "vK" + letters[1];
+    if(tables.count(canonical) || (letters[0].empty() && letters[1].empty()))
+        return true;
+
+    // Smaller tables first: one piece less for every capture, a pawn turned into each piece for every promotion
+    for(int color=0; color<2; ++color) {
+        for(size_t i=0; i<letters[color].size(); ++i) {
+            string captured[2] = { letters[0], letters[1] };
+            captured[color].erase(i, 1);
+            generate("K" + captured[0] + "vK" + captured[1], threads, log);
+
+            if(letters[color][i] != 'P')
+                continue;
+            for(int p=0; p<4; ++p) {
+                string promoted[2] = { letters[0], letters[1] };
+                promoted[color][i] = pieceLetters[p];
+                generate("K" + promoted[0] + "vK" + promoted[1], threads, log);
+            }
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    generateTable(canonical, threads);
+
+    if(log != nullptr) {
+        const vector<uint8_t> &entries = tables[canonical];
+        uint64_t wins = 0, losses = 0, draws = 0;
+        int longest = 0;
+        for(uint8_t entry : entries) {
+            if(isWin(entry)) ++wins;
+            else if(isLoss(entry)) ++losses;
+            else if(entry == DRAW) ++draws;
+            longest = std::max(longest, pliesOf(entry));
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        *log << canonical << ": " << wins << " wins, " << draws << " draws, " << losses << " losses, longest mate "
+             << longest << " plies, " << seconds << " s" << endl;
+    }
+    return true;
+}
+
+void Tablebases::generateTable(const string &name, int threads) {
+    string letters[2];
+    parseName(name, letters[0], letters[1]);
+
+    // The pieces of the table in index order
+    Position layout;
+    layout.count = 2;
+    layout.type[0] = layout.type[1] = PieceType::King;
+    layout.color[0] = 0;
+    layout.color[1] = 1;
+    for(int color=0; color<2; ++color) {
+        for(char letter : letters[color]) {
+            layout.type[layout.count] = letterTypes[pieceLetters.find(letter)];
+            layout.color[layout.count++] = color;
+        }
+    }
+    const int count = layout.count;
+    const uint64_t size = 1ULL << (6 * count + 1);
+
+    auto decode = [&](uint64_t index, Position &position) {
+        position = layout;
+        for(int i=count - 1; i>=0; --i) {
+            position.square[i] = static_cast<int>(index & 63);
+            index >>= 6;
+        }
+        position.side = static_cast<int>(index);
+        position.updateOccupancy();
+    };
+    auto encode = [&](const Position &position) {
+        uint64_t index = static_cast<uint64_t>(position.side);
+        for(int i=0; i<count; ++i)
+            index = (index << 6) | static_cast<uint64_t>(position.square[i]);
+        return index;
+    };
+
+    // The threads write the entries of other positions while they go through theirs, so every entry is an atomic byte.
+    // The count of each position is its moves inside the table that are not known to reach a win of the opponent yet,
+    // the position is lost once it gets to 0.
+    std::unique_ptr<std::atomic<uint8_t>[]> entries(new std::atomic<uint8_t>[size]);
+    std::unique_ptr<std::atomic<uint8_t>[]> moveCounts(new std::atomic<uint8_t>[size]);
+    // Best result of the captures and promotions of each position, from the side to move's view
+    std::unique_ptr<uint8_t[]> exits(new uint8_t[size]);
+    std::atomic<int> longestExit(0);
+
+    // Find the positions that can't happen, the checkmates, and the results of leaving the table
+    parallelFor(size, threads, [&](uint64_t begin, uint64_t end) {
+        Position position;
+        int longest = 0;
+        for(uint64_t index=begin; index<end; ++index) {
+            moveCounts[index].store(0, std::memory_order_relaxed);
+            exits[index] = NO_EXIT;
+            decode(index, position);
+
+            bool legal = popCount(position.occupied()) == count
+                         && !isAttacked(position, position.square[1 - position.side], position.side);
+            for(int i=2; i<count && legal; ++i) {
+                if(position.type[i] == PieceType::Pawn && (rowOf(position.square[i]) == 0 || rowOf(position.square[i]) == 7))
+                    legal = false;
+            }
+            if(!legal) {
+                entries[index].store(ILLEGAL, std::memory_order_relaxed);
+                continue;
+            }
+
+            int legalMoves = 0, tableMoves = 0;
+            uint8_t bestExit = NO_EXIT;
+            forEachLegalMove(position, [&](const Position &child, int captured, PieceType promotion) {
+                ++legalMoves;
+                if(captured < 0 && promotion == PieceType::Empty) {
+                    ++tableMoves;
+                    return;
+                }
+                Man men[MAX_MEN];
+                int menCount = 0;
+                for(int i=0; i<count; ++i) {
+                    if(child.square[i] >= 0)
+                        men[menCount++] = { child.type[i], child.color[i], child.square[i] };
+                }
+                int childEntry = probeMen(men, menCount, child.side);
+                uint8_t result = fromChild(childEntry < 0 ? DRAW : childEntry);
+                if(bestExit == NO_EXIT || rankOf(result) > rankOf(bestExit))
+                    bestExit = result;
+            });
+
+            exits[index] = bestExit;
+            moveCounts[index].store(static_cast<uint8_t>(tableMoves), std::memory_order_relaxed);
+            if(bestExit != NO_EXIT)
+                longest = std::max(longest, pliesOf(bestExit));
+
+            uint8_t entry = UNRESOLVED;
+            if(legalMoves == 0) {
+                // Checkmate, or stalemate which stays a draw
+                if(isAttacked(position, position.square[position.side], 1 - position.side))
+                    entry = lossEntry(0);
+            } else if(tableMoves == 0 && bestExit != DRAW) {
+                // Every move leaves the table, the best one decides
+                entry = bestExit;
+            }
+            entries[index].store(entry, std::memory_order_relaxed);
+        }
+
+        int known = longestExit.load();
+        while(longest > known && !longestExit.compare_exchange_weak(known, longest)) {}
+    });
+
+    // Step by step: the moves of the positions that found their result with plies - 1 are taken back. A position one
+    // move before a loss is a win with plies, and a position whose last move is found to reach a win of the opponent is
+    // a loss. Positions that win by leaving the table with plies get their result too.
+    int lastChange = 0;
+    for(int plies=1; plies <= lastChange + 1 || plies <= longestExit + 1; ++plies) {
+        std::atomic<uint64_t> changed(0);
+        parallelFor(size, threads, [&](uint64_t begin, uint64_t end) {
+            Position position;
+            uint64_t changedHere = 0;
+            for(uint64_t index=begin; index<end; ++index) {
+                uint8_t entry = entries[index].load(std::memory_order_relaxed);
+                if(entry == UNRESOLVED && isWin(exits[index]) && pliesOf(exits[index]) == plies) {
+                    uint8_t expected = UNRESOLVED;
+                    if(entries[index].compare_exchange_strong(expected, exits[index], std::memory_order_relaxed))
+                        ++changedHere;
+                    continue;
+                }
+                if(!(isWin(entry) || isLoss(entry)) || pliesOf(entry) != plies - 1)
+                    continue;
+
+                // Take back every move of the side that just moved: no captures or promotions, they come from
+                // other tables
+                decode(index, position);
+                int mover = 1 - position.side;
+                Bitboard occupied = position.occupied();
+                for(int i=0; i<count; ++i) {
+                    if(position.color[i] != mover)
+                        continue;
+
+                    int to = position.square[i];
+                    Bitboard origins;
+                    if(position.type[i] == PieceType::Pawn) {
+                        // A pawn on its starting row has no move to take back
+                        int back = mover == 0 ? 8 : -8;
+                        origins = 0;
+                        if(rowOf(to) != (mover == 0 ? 6 : 1) && !(occupied & squareBit(to + back))) {
+                            origins |= squareBit(to + back);
+                            if(rowOf(to) == (mover == 0 ? 4 : 3) && !(occupied & squareBit(to + 2 * back)))
+                                origins |= squareBit(to + 2 * back);
+                        }
+                    } else {
+                        origins = attacksOf(position.type[i], mover, to, occupied) & ~occupied;
+                    }
+
+                    while(origins) {
+                        Position previous = position;
+                        previous.square[i] = popLowestSquare(origins);
+                        previous.side = mover;
+                        uint64_t previousIndex = encode(previous);
+                        if(entries[previousIndex].load(std::memory_order_relaxed) != UNRESOLVED)
+                            continue;
+
+                        if(isLoss(entry)) {
+                            uint8_t expected = UNRESOLVED;
+                            if(entries[previousIndex].compare_exchange_strong(expected, winEntry(plies), std::memory_order_relaxed))
+                                ++changedHere;
+                        } else if(moveCounts[previousIndex].fetch_sub(1, std::memory_order_relaxed) == 1) {
+                            // Every move inside the table loses, leaving the table has to lose too
+                            uint8_t exit = exits[previousIndex];
+                            if(exit == NO_EXIT || isLoss(exit)) {
+                                entries[previousIndex].store(lossEntry(std::max(plies, pliesOf(exit))), std::memory_order_relaxed);
+                                ++changedHere;
+                            }
+                        }
+                    }
+                }
+            }
+            changed += changedHere;
+        });
+
+        if(changed > 0)
+            lastChange = plies;
+    }
+
+    // The positions without a result are draws
+    vector<uint8_t> &table = tables[name];
+    table.resize(size);
+    for(uint64_t index=0; index<size; ++index) {
+        uint8_t entry = entries[index].load(std::memory_order_relaxed);
+        table[index] = entry == UNRESOLVED ? DRAW : entry;
+    }
+    maxMen = std::max(maxMen, count);
+}
+
+bool Tablebases::save(const string &directory) const {
+    for(const std::pair<const string, vector<uint8_t> > &table : tables) {
+        const string &name = table.first;
+        const vector<uint8_t> &entries = table.second;
+        int count = static_cast<int>(name.size()) - 1;
+        bool pawns = name.find('P') != string::npos;
+
+        // Header: magic, version, name and number of entries of the table. Then the entries of the smallest index of
+        // each symmetry group in index order, where a run of 4 or more of the same entry is FILE_RUN, the entry and the
+        // length of the run (7 bits per byte, the high bit set on every byte but the last).
+        string bytes = FILE_MAGIC;
+        bytes += static_cast<char>(FILE_VERSION);
+        bytes += static_cast<char>(name.size());
+        bytes += name;
+        writeNumber(bytes, entries.size(), 8);
+
+        vector<uint8_t> kept;
+        for(uint64_t index=0; index<entries.size(); ++index) {
+            if(canonicalIndex(index, count, pawns) == index)
+                kept.push_back(entries[index]);
+        }
+
+        for(size_t i=0; i<kept.size();) {
+            size_t run = 1;
+            while(i + run < kept.size() && kept[i + run] == kept[i])
+                ++run;
+            if(run < 4) {
+                bytes.append(run, static_cast<char>(kept[i]));
+            } else {
+                bytes += static_cast<char>(FILE_RUN);
+                bytes += static_cast<char>(kept[i]);
+                for(uint64_t length = run; ; length >>= 7) {
+                    if(length < 128) {
+                        bytes += static_cast<char>(length);
+                        break;
+                    }
+                    bytes += static_cast<char>((length & 127) | 128);
+                }
+            }
+            i += run;
+        }
+
+        ofstream output((directory + "/" + name + ".nstb").c_str(), std::ios::binary);
+        output.write(bytes.data(), bytes.size());
+        if(!output.good())
+            return false;
+    }
+    return true;
+}
+
+int Tablebases::load(const string &directory) {
+    DIR *files = opendir(directory.c_str());
+    if(files == nullptr)
+        return 0;
+    vector<string> fileNames;
+    while(dirent *entry = readdir(files)) {
+        string fileName = entry->d_name;
+        if(fileName.size() > 5 && fileName.compare(fileName.size() - 5, 5, ".nstb") == 0)
+            fileNames.push_back(directory + "/" + fileName);
+    }
+    closedir(files);
+
+    int threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    int loaded = 0;
+    for(const string &fileName : fileNames) {
+        ifstream input(fileName.c_str(), std::ios::binary);
+        string bytes((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+
+        // Check the header, and that the name is a table of the size the file says
+        if(bytes.size() < 6 || bytes.compare(0, 4, FILE_MAGIC) != 0 || bytes[4] != FILE_VERSION)
+            continue;
+        size_t nameLength = static_cast<unsigned char>(bytes[5]);
+        if(bytes.size() < 14 + nameLength)
+            continue;
+        string name = bytes.substr(6, nameLength);
+        string white, black;
+        if(!parseName(name, white, black) || name != "K" + white + "vK" + black)
+            continue;
+        int count = 2 + static_cast<int>(white.size() + black.size());
+        uint64_t size = readNumber(bytes, 6 + nameLength, 8);
+        if(count > MAX_MEN || size != 1ULL << (6 * count + 1))
+            continue;
+        bool pawns = name.find('P') != string::npos;
+
+        // Unpack the kept entries
+        vector<uint8_t> kept;
+        size_t position = 14 + nameLength;
+        while(position < bytes.size()) {
+            uint8_t entry = static_cast<uint8_t>(bytes[position++]);
+            if(entry != FILE_RUN) {
+                kept.push_back(entry);
+                continue;
+            }
+            if(position == bytes.size())
+                break;
+            entry = static_cast<uint8_t>(bytes[position++]);
+            uint64_t run = 0;
+            for(int shift=0; position < bytes.size() && shift < 64; shift += 7) {
+                unsigned char byte = static_cast<unsigned char>(bytes[position++]);
+                run |= static_cast<uint64_t>(byte & 127) << shift;
+                if(!(byte & 128))
+                    break;
+            }
+            if(run > size)
+                break;
+            kept.insert(kept.end(), run, entry);
+        }
+
+        // Put them back at their indexes, then copy them to the other positions of their symmetry groups
+        vector<uint8_t> entries(size);
+        size_t next = 0;
+        for(uint64_t index=0; index<size && next <= kept.size(); ++index) {
+            if(canonicalIndex(index, count, pawns) == index) {
+                if(next < kept.size())
+                    entries[index] = kept[next];
+                ++next;
+            }
+        }
+        if(next != kept.size())
+            continue;
+        // The canonical entries are only read here, never written: another thread may be copying one of them
+        parallelFor(size, threads, [&](uint64_t begin, uint64_t end) {
+            for(uint64_t index=begin; index<end; ++index) {
+                uint64_t canonical = canonicalIndex(index, count, pawns);
+                if(canonical != index)
+                    entries[index] = entries[canonical];
+            }
+        });
+
+        tables[name].swap(entries);
+        maxMen = std::max(maxMen, count);
+        ++loaded;
+    }
+    return loaded;
+}
@@ -0,0 +1,84 @@
+/* Endgame tablebases: the exact result of every position of a small set of pieces (like King and Queen against King),
+ * with the distance to mate, so the search can play these endgames perfectly without searching them.
+ *
+ * A table is built by retrograde analysis: the checkmates are found first, then the positions that can reach a
+ * checkmated position in one move are wins in 1, the positions where every move reaches such a win are losses in 2,
+ * and so on until nothing changes. The positions left are draws. Captures and promotions leave the table, their
+ * results come from the smaller tables (KQvKR needs KQvK, KRvK...), which are built first.
+ * Each step goes through the positions on several threads.
+ *
+ * A table has an entry for every placement of its pieces and each side to move: 2 * 64^men one-byte entries, 33.5 MB
+ * for 4 men. Tables are named after their pieces, white first (KQvKR), the side with the stronger pieces is always white
+ * in the table and a position with the colors the other way is looked up flipped. Castling rights and en passant are
+ * not in the tables, positions that have them are not looked up.
+ *
+ * Saved tables are .nstb files in a directory: a header and the entries run-length encoded, which makes them a small
+ * part of their size in memory since most of a table is long runs of the same result. */
+
+#ifndef CHESS_TABLEBASE_H
+#define CHESS_TABLEBASE_H
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include "Board.h"
+
+// Result of a position for the side to move
+enum class WDL { Loss, Draw, Win };
+
+struct TablebaseResult {
+    WDL wdl;
+    int plies;  // Plies to the checkmate with the best play of both sides, 0 for a draw (and for being checkmated)
+};
+
+class Tablebases {
+public:
+    // Most pieces (Kings included) a table can have, a 5 men table would need 2 GB in memory
+    static const int MAX_MEN = 4;
+
+    Tablebases();
+
+    // Builds the table of the pieces (like "KQvKR", "KRPvK" or "KBNK") and every smaller table it needs that isn't
+    // there yet, with the given number of threads. Progress lines go to the log if one is given.
+    // Returns false if the name is not a set of pieces with up to MAX_MEN men.
+    bool generate(const string &name, int threads, std::ostream *log = nullptr);
+
+    // Writes every table to the directory as <name>.nstb / reads every .nstb file of the directory.
+    // save returns false if a file can't be written, load returns the number of tables read.
+    bool save(const string &directory) const;
+    int load(const string &directory);
+
+    // Returns the names of the tables that are there, in name order
+    vector<string> getNames() const;
+
+    // Returns the most men of the tables there are, 0 if there are none
+    int getMaxMen() const { return maxMen; }
+
+    // Finds the result of the board's position. Returns false if there is no table for its pieces, or the position has
+    // castling rights or an en passant square.
+    bool probe(const Board &board, TablebaseResult &result) const;
+
+    // Finds the move that keeps the best result in the board's position: the fastest mate when winning, a drawing move
+    // when drawn, the slowest mate when losing. Returns false like probe, or if there is no legal move.
+    bool bestMove(Board &board, Move &move, TablebaseResult &result) const;
+
+private:
+    // One piece of a position as the tables see it
+    struct Man {
+        PieceType type;
+        int color;
+        int square;
+    };
+
+    // Returns the one-byte entry of the position (see Tablebase.cpp) of the pieces, -1 if there is no table for them
+    int probeMen(Man *men, int count, int side) const;
+
+    // Builds the table of the canonical name, the tables it needs have to be there
+    void generateTable(const string &name, int threads);
+
+    // Entries of each table by name
+    std::map<string, vector<uint8_t> > tables;
+    int maxMen;
+};
+
+#endif //CHESS_TABLEBASE_H
@@ -0,0 +1,85 @@
+#include "TranspositionTable.h"
+
+TranspositionTable::TranspositionTable(int megabytes) : slotCount(0), indexMask(0), sizeMB(0) {
+    resize(megabytes);
+}
+
+void TranspositionTable::resize(int megabytes) {
+    if(megabytes < 1)
+        megabytes = 1;
+
+    // A power of two number of slots lets the index be the low bits of the key
+    size_t maxSlots = static_cast<size_t>(megabytes) * 1024 * 1024 / sizeof(Slot);
+    size_t count = 1;
+    while(count * 2 <= maxSlots)
+        count *= 2;
+
+    slots.reset(new Slot[count]);
+    slotCount = count;
+    indexMask = count - 1;
+    sizeMB = megabytes;
+    clear();
+}
+
+void TranspositionTable::clear() {
+    for(size_t i=0; i<slotCount; ++i) {
+        slots[i].keyXorData.store(0, std::memory_order_relaxed);
+        slots[i].data.store(0, std::memory_order_relaxed);
+    }
+}
+
+bool TranspositionTable::probe(uint64_t key, TTEntry &entry) const {
+    const Slot &slot = slots[key & indexMask];
+    uint64_t data = slot.data.load(std::memory_order_relaxed);
+    uint64_t keyXorData = slot.keyXorData.load(std::memory_order_relaxed);
+
+    // Empty slots have data 0, which is Bound::None with no move. A slot of a different position, or one written by
+    // another thread between the two loads, doesn't give the key back.
+    if((keyXorData ^ data) != key || data == 0)
+        return false;
+
+    entry = unpack(data);
+    return true;
+}
+
+void TranspositionTable::store(uint64_t key, int depth, Bound bound, int score, const Move &move) {
+    Slot &slot = slots[key & indexMask];
+
+    uint64_t oldData = slot.data.load(std::memory_order_relaxed);
+    if((slot.keyXorData.load(std::memory_order_relaxed) ^ oldData) == key && oldData != 0) {
+        TTEntry old = unpack(oldData);
+        // A shallower search of the same position doesn't replace a deeper one, unless it has an exact score
+        if(old.depth > depth && bound != Bound::Exact)
+            return;
+    }
+
+    uint64_t data = pack(depth, bound, score, move);
+    slot.keyXorData.store(key ^ data, std::memory_order_relaxed);
+    slot.data.store(data, std::memory_order_relaxed);
+}
+
+uint64_t TranspositionTable::pack(int depth, Bound bound, int score, const Move &move) {
+    if(depth < 0)
+        depth = 0;
+    if(depth > 255)
+        depth = 255;
+
+    uint64_t data = move.from;
+    data |= static_cast<uint64_t>(move.to) << 6;
+    data |= static_cast<uint64_t>(static_cast<int>(move.promotion) & 7) << 12;
+    data |= static_cast<uint64_t>(static_cast<int>(bound)) << 15;
+    data |= static_cast<uint64_t>(depth) << 17;
+    data |= static_cast<uint64_t>(static_cast<uint16_t>(static_cast<int16_t>(score))) << 25;
+    return data;
+}
+
+TTEntry TranspositionTable::unpack(uint64_t data) {
+    TTEntry entry;
+    entry.move.from = static_cast<uint8_t>(data & 63);
+    entry.move.to = static_cast<uint8_t>((data >> 6) & 63);
+    entry.move.promotion = static_cast<PieceType>((data >> 12) & 7);
+    entry.bound = static_cast<Bound>((data >> 15) & 3);
+    entry.depth = static_cast<int>((data >> 17) & 255);
+    entry.score = static_cast<int16_t>(static_cast<uint16_t>(data >> 25));
+    return entry;
+}
@@ -0,0 +1,73 @@
+/* Transposition table: a fixed-size hash table of search results, indexed by the Zobrist key of the position.
+ * The same position is often reached by different move orders, a result stored once can be reused by all of them.
+ * Every entry is 16 bytes: the full key (to tell positions that share a slot apart) and the packed result.
+ *
+ * Several search threads use the same table without locks. A slot keeps the key XORed with the result, so a slot that
+ * one thread read while another was writing it (half old, half new) doesn't match the key and is treated as empty. */
+
+#ifndef CHESS_TRANSPOSITIONTABLE_H
+#define CHESS_TRANSPOSITIONTABLE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "Board.h"
+
+// What the stored score says about the real score of the position
+enum class Bound : uint8_t {
+    None,   // No score, the entry only has a best move
+    Upper,  // No move reached alpha, the real score is at most the stored score
+    Lower,  // A move reached beta and the search stopped there, the real score is at least the stored score
+    Exact   // The stored score is the real score (at the stored depth)
+};
+
+// Search result of a position read from the table
+struct TTEntry {
+    Move move;   // Best move found, from == to if there is none
+    int score;
+    int depth;
+    Bound bound;
+};
+
+class TranspositionTable {
+public:
+    static const int DEFAULT_SIZE_MB = 16;
+
+    // Creates a table that uses the given megabytes of memory (rounded down to a power of two number of entries)
+    explicit TranspositionTable(int megabytes = DEFAULT_SIZE_MB);
+
+    // Changes the size of the table, every stored entry is lost. Not safe while a search is using the table.
+    void resize(int megabytes);
+
+    // Forgets every stored entry. Not safe while a search is using the table.
+    void clear();
+
+    // Returns the size of the table in megabytes
+    int getSizeMB() const { return sizeMB; }
+
+    // Returns true and fills the entry if the table has a result for the position with this key
+    bool probe(uint64_t key, TTEntry &entry) const;
+
+    // Stores the result of a search of the position with this key. The entry of a deeper search of the same position is
+    // kept over a shallower one, results of other positions are replaced.
+    void store(uint64_t key, int depth, Bound bound, int score, const Move &move);
+
+private:
+    // Relaxed atomics compile to plain loads and stores, the XOR check is what keeps the entries consistent
+    struct Slot {
+        std::atomic<uint64_t> keyXorData;
+        std::atomic<uint64_t> data;
+    };
+
+    // Packs the result into 64 bits: from (6 bits), to (6), promotion (3), bound (2), depth (8) and score (16)
+    static uint64_t pack(int depth, Bound bound, int score, const Move &move);
+    static TTEntry unpack(uint64_t data);
+
+    std::unique_ptr<Slot[]> slots;
+    size_t slotCount;
+    uint64_t indexMask;
+    int sizeMB;
+};
+
+#endif //CHESS_TRANSPOSITIONTABLE_H
@@ -0,0 +1,211 @@
+#include "Uci.h"
+
+namespace {
+    const string startFen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+    // UCI scores are in centipawns, or in moves to mate (negative when the engine gets mated)
+    string scoreToString(int score) {
+        if(Search::isMateScore(score))
+            return "mate " + std::to_string(Search::movesToMate(score));
+        return "cp " + std::to_string(score);
+    }
+}
+
+Uci::Uci() : stopFlag(false), waitForStop(false) {
+    board.setFromFen(startFen);
+    search.setIterationCallback([this](const SearchResult &result) { sendInfo(result); });
+}
+
+int Uci::run() {
+    string line;
+    while(getline(std::cin, line)) {
+        std::istringstream arguments(line);
+        string command;
+        arguments >> command;
+
+        if(command == "uci") {
+            handleUci();
+        } else if(command == "isready") {
+            send("readyok");
+        } else if(command == "ucinewgame") {
+            stopSearch();
+            search.clearHash();
+            board.setFromFen(startFen);
+        } else if(command == "setoption") {
+            stopSearch();
+            handleSetOption(arguments);
+        } else if(command == "position") {
+            stopSearch();
+            handlePosition(arguments);
+        } else if(command == "go") {
+            stopSearch();
+            handleGo(arguments);
+        } else if(command == "stop") {
+            stopSearch();
+        } else if(command == "quit") {
+            break;
+        }
+        // Unknown commands are ignored, as the protocol asks
+    }
+
+    stopSearch();
+    return 0;
+}
+
+void Uci::handleUci() {
+    send("id name not-so-smart-chess");
+    send("id author erenozer");
+    send("option name Hash type spin default " + std::to_string(TranspositionTable::DEFAULT_SIZE_MB) + " min 1 max 65536");
+    send("option name Threads type spin default 1 min 1 max 256");
+    send("option name Book type string default <empty>");
+    send("option name TablebasePath type string default <empty>");
+    send("uciok");
+}
+
+void Uci::handleSetOption(std::istringstream &arguments) {
+    // setoption name <name> value <value>, the name may have spaces in it
+    string word, name, value;
+    arguments >> word;
+    while(arguments >> word && word != "value")
+        name += (name.empty() ? "" : " ") + word;
+    arguments >> value;
+
+    if(name == "Hash")
+        search.setHashSize(atoi(value.c_str()));
+    else if(name == "Threads")
+        search.setThreads(atoi(value.c_str()));
+    else if(name == "Clear Hash")
+        search.clearHash();
+    else if(name == "Book") {
+        // The value is a path, it can have spaces in it
+        string path = value, rest;
+        while(arguments >> rest)
+            path += " " + rest;
+        if(path.empty() || path == "<empty>")
+            book.close();
+        else if(!book.open(path))
+            send("info string can't open the book " + path);
+    }
+    else if(name == "TablebasePath") {
+        string path = value, rest;
+        while(arguments >> rest)
+            path += " " + rest;
+        // Tables are replaced, not added to (no search is running, setoption stopped it)
+        tablebases = Tablebases();
+        search.setTablebases(nullptr);
+        if(path.empty() || path == "<empty>")
+            return;
+        int count = tablebases.load(path);
+        if(count == 0)
+            send("info string no endgame tables in " + path);
+        else {
+            send("info string " + std::to_string(count) + " endgame tables loaded");
+            search.setTablebases(&tablebases);
+        }
+    }
+}
+
+void Uci::handlePosition(std::istringstream &arguments) {
+    // position startpos [moves ...] or position fen <fen> [moves ...]
+    string word, fen;
+    arguments >> word;
+    if(word == "startpos") {
+        fen = startFen;
+        arguments >> word;
+    } else if(word == "fen") {
+        while(arguments >> word && word != "moves")
+            fen += (fen.empty() ? "" : " ") + word;
+    } else {
+        return;
+    }
+
+    if(!board.setFromFen(fen)) {
+        send("info string invalid fen " + fen);
+        board.setFromFen(startFen);
+        return;
+    }
+
+    if(word != "moves")
+        return;
+    while(arguments >> word) {
+        Move move;
+        if(!board.parseMove(word, move)) {
+            send("info string illegal move " + word);
+            return;
+        }
+        board.makeMove(move);
+    }
+}
+
+void Uci::handleGo(std::istringstream &arguments) {
+    SearchLimits limits;
+    int time[2] = { 0, 0 };
+    int increment[2] = { 0, 0 };
+    int movesToGo = 0;
+    bool infinite = false;
+
+    string word;
+    while(arguments >> word) {
+        if(word == "depth") arguments >> limits.depth;
+        else if(word == "movetime") arguments >> limits.moveTime;
+        else if(word == "nodes") arguments >> limits.nodes;
+        else if(word == "wtime") arguments >> time[0];
+        else if(word == "btime") arguments >> time[1];
+        else if(word == "winc") arguments >> increment[0];
+        else if(word == "binc") arguments >> increment[1];
+        else if(word == "movestogo") arguments >> movesToGo;
+        else if(word == "infinite") infinite = true;
+    }
+
+    // With a clock, the time of the move is a share of the remaining time (see moveTimeFromClock)
+    int color = board.getSideToMove();
+    if(limits.moveTime == 0 && time[color] > 0)
+        limits.moveTime = moveTimeFromClock(time[color], increment[color], movesToGo);
+
+    Move bookMove;
+    if(!infinite && book.pickMove(board, bookMove)) {
+        send("info string book move");
+        send("bestmove " + moveToString(bookMove));
+        return;
+    }
+
+    stopFlag = false;
+    waitForStop = infinite;
+    limits.stop = &stopFlag;
+
+    // The thread searches its own copy of the board, the next position command can change this one
+    Board position = board;
+    searchThread = std::thread([this, position, limits]() mutable {
+        SearchResult result = search.think(position, limits);
+
+        // go infinite has to wait for stop before giving the move
+        while(waitForStop && !stopFlag)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        // from == to when there is no legal move, UCI writes that as 0000
+        send("bestmove " + (result.bestMove.from == result.bestMove.to ? string("0000") : moveToString(result.bestMove)));
+    });
+}
+
+void Uci::stopSearch() {
+    if(!searchThread.joinable())
+        return;
+
+    stopFlag = true;
+    searchThread.join();
+}
+
+void Uci::send(const string &line) {
+    std::lock_guard<std::mutex> lock(outputMutex);
+    cout << line << endl;
+}
+
+void Uci::sendInfo(const SearchResult &result) {
+    uint64_t milliseconds = static_cast<uint64_t>(result.seconds * 1000);
+    uint64_t nodesPerSecond = result.seconds > 0 ? static_cast<uint64_t>(result.nodes / result.seconds) : 0;
+
+    std::ostringstream info;
+    info << "info depth " << result.depth << " score " << scoreToString(result.score) << " nodes " << result.nodes
+         << " nps " << nodesPerSecond << " time " << milliseconds << " pv " << moveToString(result.bestMove);
+    send(info.str());
+}
@@ -0,0 +1,54 @@
+/* UCI (Universal Chess Interface) mode: the engine reads commands from standard input and answers on standard output,
+ * so chess GUIs and other tools can drive it without the interactive prompt.
+ * Supported commands: uci, isready, ucinewgame, setoption (Hash, Threads, Book, TablebasePath), position (startpos or fen, then moves),
+ * go (depth, movetime, nodes, infinite, wtime/btime/winc/binc/movestogo), stop and quit.
+ * The search runs on its own thread, so stop (and every other command) is answered while it is searching. */
+
+#ifndef CHESS_UCI_H
+#define CHESS_UCI_H
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include "Board.h"
+#include "OpeningBook.h"
+#include "Search.h"
+#include "Tablebase.h"
+
+class Uci {
+public:
+    Uci();
+
+    // Reads and answers commands until "quit" or the end of the input, returns the exit code of the program
+    int run();
+
+private:
+    void handleUci();
+    void handleSetOption(std::istringstream &arguments);
+    void handlePosition(std::istringstream &arguments);
+    void handleGo(std::istringstream &arguments);
+
+    // Stops the running search (if any) and waits for it to print its best move
+    void stopSearch();
+
+    // Prints one line of output. The search thread prints too, the lines must not mix.
+    void send(const string &line);
+
+    // Prints an info line with the progress of the search
+    void sendInfo(const SearchResult &result);
+
+    Board board;
+    Search search;
+    // Moves of the book are played without searching (except for go infinite)
+    OpeningBook book;
+    // Endgame tables the search looks positions up in
+    Tablebases tablebases;
+
+    std::thread searchThread;
+    std::atomic<bool> stopFlag;
+    // Set by go infinite: the best move is only printed after stop, even if the search ends before it
+    std::atomic<bool> waitForStop;
+    std::mutex outputMutex;
+};
+
+#endif //CHESS_UCI_H
@@ -0,0 +1,64 @@
+#include "Zobrist.h"
+
+namespace {
+    uint64_t pieceKeys[2][6][64];
+    uint64_t castlingKeys[16];
+    uint64_t enPassantKeys[8];
+    uint64_t sideKey;
+
+    // SplitMix64 random number generator, small and good enough for hash keys
+    uint64_t nextRandom(uint64_t &state) {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    void buildKeys() {
+        uint64_t state = 20240317;
+
+        for(int color=0; color<2; ++color)
+            for(int type=0; type<6; ++type)
+                for(int square=0; square<64; ++square)
+                    pieceKeys[color][type][square] = nextRandom(state);
+
+        // Each right has its own key, a set of rights uses the XOR of its rights' keys
+        uint64_t rightKeys[4];
+        for(int i=0; i<4; ++i)
+            rightKeys[i] = nextRandom(state);
+        for(int rights=0; rights<16; ++rights) {
+            castlingKeys[rights] = 0;
+            for(int i=0; i<4; ++i) {
+                if(rights & (1 << i))
+                    castlingKeys[rights] ^= rightKeys[i];
+            }
+        }
+
+        for(int col=0; col<8; ++col)
+            enPassantKeys[col] = nextRandom(state);
+
+        sideKey = nextRandom(state);
+    }
+}
+
+void initZobrist() {
+    // Function-local static is initialized exactly once, even when several boards are created at the same time
+    static const bool initialized = (buildKeys(), true);
+    (void)initialized;
+}
+
+uint64_t zobristPiece(int color, int type, int square) {
+    return pieceKeys[color][type][square];
+}
+
+uint64_t zobristCastling(int rights) {
+    return castlingKeys[rights];
+}
+
+uint64_t zobristEnPassant(int col) {
+    return enPassantKeys[col];
+}
+
+uint64_t zobristSide() {
+    return sideKey;
+}
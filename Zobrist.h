@@ -0,0 +1,25 @@
+/* Zobrist hashing: every piece on every square, every castling right, the en passant file and the side to move has
+ * a random 64-bit key. The key of a position is all of its keys XORed together, so a move changes it with a few XORs.
+ * The keys come from a fixed seed, so the same position has the same key in every run (saved files can use them). */
+
+#ifndef CHESS_ZOBRIST_H
+#define CHESS_ZOBRIST_H
+
+#include <cstdint>
+
+// Fills the key tables below. Safe to call more than once, the tables are only built the first time.
+void initZobrist();
+
+// Key of a piece of the color (0 for white, 1 for black) and type (PieceType as int) standing on the square
+uint64_t zobristPiece(int color, int type, int square);
+
+// Key of a set of castling rights, one bit for each: 1 white King side, 2 white Queen side, 4 black King side, 8 black Queen side
+uint64_t zobristCastling(int rights);
+
+// Key of an en passant capture possible on the col
+uint64_t zobristEnPassant(int col);
+
+// Key added when black is to move
+uint64_t zobristSide();
+
+#endif //CHESS_ZOBRIST_H
@@ -0,0 +1,181 @@
+/* Sliding piece benchmark: the square by square path walk isLegalMove used before (isPathEmpty) against the attack
+ * table lookups that replaced it, with magic multiplication and with PEXT (when the CPU has it).
+ * Every Rook, Bishop and Queen of a few positions is asked whether it can move to every square of the board; all the
+ * ways have to give the same answers, and the time of each query is reported.
+ *
+ * Usage:
+ *   bench_attacks [repetitions]    repeats the queries the given times (default 2000) */
+
+#include <chrono>
+#include <iomanip>
+#include "Board.h"
+
+namespace {
+    const char *benchPositions[] = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    };
+
+    // Can the piece on from move to the square to?
+    struct Query {
+        Bitboard occupied;
+        Bitboard own;   // Pieces of the moving piece's color
+        uint8_t from;
+        uint8_t to;
+        PieceType type;
+    };
+
+    // The check isLegalMove did before the attack tables: walk from the old slot towards the new slot one square at a
+    // time, then check that the move is straight (Rook), diagonal (Bishop) or either (Queen)
+    bool walkPath(const Query &query) {
+        int old_row = rowOf(query.from), old_col = colOf(query.from);
+        int new_row = rowOf(query.to), new_col = colOf(query.to);
+        Bitboard occupancy = query.occupied;
+        bool differentColors = !(query.own & squareBit(query.to));
+
+        bool pathEmpty = true;
+        int rowDifference = old_row - new_row;
+        int colDifference = old_col - new_col;
+        int rowChangeDirection = rowDifference > 0 ? -1 : (rowDifference < 0 ? 1 : 0);
+        int colChangeDirection = colDifference > 0 ? -1 : (colDifference < 0 ? 1 : 0);
+        int row = old_row, col = old_col;
+
+        if(rowDifference != 0 && colDifference != 0) {
+            while(row != new_row && col != new_col) {
+                row += rowChangeDirection;
+                col += colChangeDirection;
+                if(occupancy & squareBit(toSquare(row, col))) {
+                    pathEmpty = row == new_row && col == new_col && differentColors;
+                    break;
+                }
+            }
+        } else if(rowDifference != 0) {
+            while(row != new_row) {
+                row += rowChangeDirection;
+                if(occupancy & squareBit(toSquare(row, col))) {
+                    pathEmpty = row == new_row && differentColors;
+                    break;
+                }
+            }
+        } else if(colDifference != 0) {
+            while(col != new_col) {
+                col += colChangeDirection;
+                if(occupancy & squareBit(toSquare(row, col))) {
+                    pathEmpty = col == new_col && differentColors;
+                    break;
+                }
+            }
+        }
+        if(!pathEmpty)
+            return false;
+
+        int rowChange = abs(rowDifference);
+        int colChange = abs(colDifference);
+        bool straight = (rowChange == 0) != (colChange == 0);
+        bool diagonal = rowChange == colChange && rowChange != 0;
+        if(query.type == PieceType::Rook)
+            return straight;
+        if(query.type == PieceType::Bishop)
+            return diagonal;
+        return straight || diagonal;
+    }
+
+    // The same check with the attack tables
+    bool lookUp(const Query &query) {
+        Bitboard attacks = 0;
+        if(query.type != PieceType::Rook)
+            attacks |= bishopAttacks(query.from, query.occupied);
+        if(query.type != PieceType::Bishop)
+            attacks |= rookAttacks(query.from, query.occupied);
+        return (attacks & ~query.own & squareBit(query.to)) != 0;
+    }
+
+    // Runs every query the given times, returns the nanoseconds per query and the number of legal answers
+    double timeQueries(const vector<Query> &queries, int repetitions, bool (*check)(const Query &), uint64_t &legal) {
+        legal = 0;
+        auto start = std::chrono::steady_clock::now();
+        for(int r=0; r<repetitions; ++r) {
+            for(const Query &query : queries)
+                legal += check(query);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return seconds * 1e9 / (static_cast<double>(queries.size()) * repetitions);
+    }
+
+    void printTiming(const string &name, double nanoseconds, double baseline, uint64_t legal) {
+        cout << std::left << std::setw(22) << name << std::right << std::fixed << std::setprecision(2)
+             << std::setw(10) << nanoseconds << " ns/query" << std::setw(10) << baseline / nanoseconds << "x"
+             << std::setw(14) << legal << " legal" << endl;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int repetitions = argc > 1 ? atoi(argv[1]) : 2000;
+    if(repetitions < 1)
+        repetitions = 2000;
+
+    // Every slider of every position, asked about every square of the board
+    vector<Query> queries;
+    for(const char *fen : benchPositions) {
+        Board board;
+        board.setFromFen(fen);
+
+        Bitboard colors[2] = { 0, 0 };
+        for(int square=0; square<64; ++square) {
+            Piece piece = board.getPiece(rowOf(square), colOf(square));
+            if(piece.getType() != PieceType::Empty)
+                colors[piece.getColor()] |= squareBit(square);
+        }
+
+        for(int from=0; from<64; ++from) {
+            Piece piece = board.getPiece(rowOf(from), colOf(from));
+            if(piece.getType() != PieceType::Rook && piece.getType() != PieceType::Bishop && piece.getType() != PieceType::Queen)
+                continue;
+
+            for(int to=0; to<64; ++to) {
+                if(to == from)
+                    continue;
+                Query query = { colors[0] | colors[1], colors[piece.getColor()], static_cast<uint8_t>(from),
+                                static_cast<uint8_t>(to), piece.getType() };
+                queries.push_back(query);
+            }
+        }
+    }
+
+    // All the ways have to agree before their times mean anything
+    SliderLookup defaultLookup = sliderLookup();
+    for(int i=0; i<2; ++i) {
+        SliderLookup lookup = i == 0 ? SliderLookup::Magic : SliderLookup::Pext;
+        if(!setSliderLookup(lookup))
+            continue;
+        for(const Query &query : queries) {
+            if(walkPath(query) != lookUp(query)) {
+                cout << "Different answers for " << moveToString(Move{ query.from, query.to, PieceType::Empty }) << endl;
+                return 1;
+            }
+        }
+    }
+
+    cout << queries.size() << " queries, " << repetitions << " repetitions" << endl;
+
+    uint64_t legal = 0;
+    double walkTime = timeQueries(queries, repetitions, walkPath, legal);
+    printTiming("isPathEmpty walk", walkTime, walkTime, legal);
+
+    setSliderLookup(SliderLookup::Magic);
+    double magicTime = timeQueries(queries, repetitions, lookUp, legal);
+    printTiming("magic lookup", magicTime, walkTime, legal);
+
+    if(setSliderLookup(SliderLookup::Pext)) {
+        double pextTime = timeQueries(queries, repetitions, lookUp, legal);
+        printTiming("PEXT lookup", pextTime, walkTime, legal);
+    } else {
+        cout << "PEXT lookup           not supported by this CPU" << endl;
+    }
+
+    setSliderLookup(defaultLookup);
+    return 0;
+}
@@ -0,0 +1,372 @@
+/* Board benchmark: times the Board functions the game and the search call the most, each on its own, so a change that
+ * makes one of them slower shows up between two builds.
+ * The positions are a fixed opening, middlegame, endgame, check and checkmate, and every save file of the saves
+ * directory. Each function is called on all of them (isLegalMove with every piece of the side to move and every square,
+ * isPieceSafe with every piece...), which is one pass. After the warm-up passes, the passes are grouped into samples of a few milliseconds,
+ * and the time per call of each sample gives the median and the percentiles.
+ *
+ * Usage:
+ *   bench_board [samples] [json file] [saves directory]
+ *     samples     timed samples of each function (default 21)
+ *     json file   also writes the results there as JSON, for comparing builds ("-" prints it instead of the table)
+ *     saves       directory of the save files to add to the positions (default saves) */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <dirent.h>
+#include "Board.h"
+#include "Search.h"
+
+// Calls the private Board functions for the benchmark (see the friend declaration in Board.h)
+struct BoardBenchAccess {
+    static bool isLegalMove(const Board &board, int oldRow, int oldCol, int newRow, int newCol) {
+        return board.isLegalMove(oldRow, oldCol, newRow, newCol);
+    }
+    static bool isPathEmpty(const Board &board, int oldRow, int oldCol, int newRow, int newCol) {
+        return board.isPathEmpty(oldRow, oldCol, newRow, newCol);
+    }
+    static bool isPieceSafe(const Board &board, int row, int col, int color) {
+        return board.isPieceSafe(row, col, color);
+    }
+    static double calculateScore(Board &board, int color) {
+        return board.calculateScore(color);
+    }
+};
+
+namespace {
+    struct BenchPosition {
+        string name;
+        Board board;
+    };
+
+    const char *fixedPositions[][2] = {
+        { "opening", "r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3" },
+        { "middlegame", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10" },
+        { "endgame", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1" },
+        // isCheckmate only tries the moves when the King is attacked
+        { "check", "rnbqkbnr/ppp2ppp/3p4/1B2p3/4P3/8/PPPP1PPP/RNBQK1NR b KQkq - 1 3" },
+        { "checkmate", "rnb1kbnr/pppp1ppp/8/4p3/6Pq/5P2/PPPPP2P/RNBQKBNR w KQkq - 1 3" },
+    };
+
+    // Depth of the suggestMove searches: deep enough to use every part of the search, short enough for many samples
+    const int SUGGEST_DEPTH = 4;
+
+    // Transposition table of each suggestMove search in megabytes, more than a search of SUGGEST_DEPTH fills
+    const int SUGGEST_HASH_SIZE = 1;
+
+    // Passes before the timing starts, so the caches and the branch predictors are warm
+    const int WARMUP_PASSES = 3;
+
+    // A sample is at least this long, shorter ones are mostly clock noise
+    const double SAMPLE_SECONDS = 0.005;
+
+    // The results of the calls are added here, so the compiler can't leave the calls out
+    volatile uint64_t sink = 0;
+
+    // A function to time: one pass over all the positions, returns the number of calls it made. If reset is given, it
+    // is called before every pass and its time is not counted.
+    struct Benchmark {
+        string name;
+        std::function<uint64_t()> pass;
+        std::function<void()> reset;
+
+        Benchmark(const string &name, const std::function<uint64_t()> &pass,
+                  const std::function<void()> &reset = nullptr) : name(name), pass(pass), reset(reset) {}
+    };
+
+    // Runs the pass (after the reset, if there is one), returns the seconds it took
+    double timePass(const Benchmark &benchmark, uint64_t &calls) {
+        if(benchmark.reset)
+            benchmark.reset();
+        auto start = std::chrono::steady_clock::now();
+        calls = benchmark.pass();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    struct BenchResult {
+        string name;
+        uint64_t callsPerSample;
+        vector<double> nanoseconds;   // Per call, of each sample, sorted
+    };
+
+    // Nearest rank percentile of the sorted values
+    double percentile(const vector<double> &sorted, double percent) {
+        size_t rank = static_cast<size_t>(std::ceil(percent / 100.0 * sorted.size()));
+        return sorted[rank == 0 ? 0 : std::min(rank, sorted.size()) - 1];
+    }
+
+    double mean(const vector<double> &values) {
+        double total = 0;
+        for(double value : values)
+            total += value;
+        return values.empty() ? 0 : total / values.size();
+    }
+
+    void addSaves(const string &path, vector<BenchPosition> &positions) {
+        DIR *directory = opendir(path.c_str());
+        if(directory == nullptr)
+            return;
+
+        // Sorted, so the positions are the same in every run
+        vector<string> fileNames;
+        while(dirent *entry = readdir(directory)) {
+            string fileName = entry->d_name;
+            if(fileName.size() > 4 && fileName.compare(fileName.size() - 4, 4, ".txt") == 0)
+                fileNames.push_back(fileName);
+        }
+        closedir(directory);
+        std::sort(fileNames.begin(), fileNames.end());
+
+        for(const string &fileName : fileNames) {
+            BenchPosition position;
+            position.name = path + "/" + fileName;
+            if(position.board.loadSave(path + "/" + fileName) != -1)
+                positions.push_back(position);
+        }
+    }
+
+    BenchResult run(const Benchmark &benchmark, int samples) {
+        uint64_t callsPerPass = 0;
+        for(int i=0; i<WARMUP_PASSES; ++i)
+            timePass(benchmark, callsPerPass);
+
+        // As many passes in a sample as fit in SAMPLE_SECONDS, measured with one more pass
+        double passSeconds = timePass(benchmark, callsPerPass);
+        int passes = passSeconds >= SAMPLE_SECONDS ? 1 : static_cast<int>(SAMPLE_SECONDS / std::max(passSeconds, 1e-9)) + 1;
+
+        BenchResult result;
+        result.name = benchmark.name;
+        result.callsPerSample = callsPerPass * passes;
+        for(int s=0; s<samples; ++s) {
+            double seconds = 0;
+            if(benchmark.reset) {
+                // Each pass is timed on its own, so the resets between them are left out
+                for(int p=0; p<passes; ++p)
+                    seconds += timePass(benchmark, callsPerPass);
+            } else {
+                auto start = std::chrono::steady_clock::now();
+                for(int p=0; p<passes; ++p)
+                    benchmark.pass();
+                seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            }
+            result.nanoseconds.push_back(seconds * 1e9 / result.callsPerSample);
+        }
+        std::sort(result.nanoseconds.begin(), result.nanoseconds.end());
+        return result;
+    }
+
+    void printTable(const vector<BenchResult> &results, std::ostream &output) {
+        output << std::left << std::setw(16) << "function" << std::right << std::setw(14) << "calls/sample"
+               << std::setw(14) << "median ns" << std::setw(12) << "p10 ns" << std::setw(12) << "p90 ns"
+               << std::setw(12) << "p99 ns" << endl;
+        for(const BenchResult &result : results) {
+            output << std::left << std::setw(16) << result.name << std::right << std::setw(14) << result.callsPerSample
+                   << std::fixed << std::setprecision(1) << std::setw(14) << percentile(result.nanoseconds, 50)
+                   << std::setw(12) << percentile(result.nanoseconds, 10)
+                   << std::setw(12) << percentile(result.nanoseconds, 90)
+                   << std::setw(12) << percentile(result.nanoseconds, 99) << endl;
+        }
+    }
+
+    // Names have no characters that need escaping, they are function names and file names of the saves directory
+    void printJson(const vector<BenchResult> &results, const vector<BenchPosition> &positions, int samples,
+                   std::ostream &output) {
+        output << std::fixed << std::setprecision(2);
+        output << "{\n  \"benchmark\": \"bench_board\",\n  \"samples\": " << samples << ",\n";
+        output << "  \"slider_lookup\": \"" << (sliderLookup() == SliderLookup::Pext ? "pext" : "magic") << "\",\n";
+        output << "  \"positions\": [";
+        for(size_t i=0; i<positions.size(); ++i)
+            output << (i > 0 ? ", " : "") << "\"" << positions[i].name << "\"";
+        output << "],\n  \"results\": [\n";
+        for(size_t i=0; i<results.size(); ++i) {
+            const BenchResult &result = results[i];
+            const vector<double> &ns = result.nanoseconds;
+            output << "    { \"name\": \"" << result.name << "\", \"calls_per_sample\": " << result.callsPerSample
+                   << ", \"ns_per_call\": { \"min\": " << ns.front() << ", \"median\": " << percentile(ns, 50)
+                   << ", \"p10\": " << percentile(ns, 10) << ", \"p90\": " << percentile(ns, 90)
+                   << ", \"p99\": " << percentile(ns, 99) << ", \"max\": " << ns.back()
+                   << ", \"mean\": " << mean(ns) << " } }" << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        output << "  ]\n}\n";
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int samples = argc > 1 ? atoi(argv[1]) : 21;
+    if(samples < 1)
+        samples = 21;
+    string jsonFile = argc > 2 ? argv[2] : "";
+    string savesDirectory = argc > 3 ? argv[3] : "saves";
+
+    vector<BenchPosition> positions;
+    for(const auto &fixed : fixedPositions) {
+        BenchPosition position;
+        position.name = fixed[0];
+        position.board.setFromFen(fixed[1]);
+        positions.push_back(position);
+    }
+    addSaves(savesDirectory, positions);
+
+    vector<Benchmark> benchmarks;
+
+    // Every piece of the side to move to every square, legal or not, like the moves a player may type
+    benchmarks.push_back({ "isLegalMove", [&positions]() {
+        uint64_t calls = 0, legal = 0;
+        for(BenchPosition &position : positions) {
+            const Board &board = position.board;
+            int color = board.getSideToMove();
+            for(int i=0; i<board.getPieceCount(color); ++i) {
+                int from = board.getPieceSquare(color, i);
+                for(int to=0; to<64; ++to) {
+                    legal += BoardBenchAccess::isLegalMove(board, rowOf(from), colOf(from), rowOf(to), colOf(to));
+                    ++calls;
+                }
+            }
+        }
+        sink = sink + legal;
+        return calls;
+    } });
+
+    // Every slider of both colors to every square on its lines
+    benchmarks.push_back({ "isPathEmpty", [&positions]() {
+        uint64_t calls = 0, empty = 0;
+        for(BenchPosition &position : positions) {
+            const Board &board = position.board;
+            for(int color=0; color<2; ++color) {
+                for(int i=0; i<board.getPieceCount(color); ++i) {
+                    int from = board.getPieceSquare(color, i);
+                    PieceType type = board.getPiece(rowOf(from), colOf(from)).getType();
+                    if(type != PieceType::Rook && type != PieceType::Bishop && type != PieceType::Queen)
+                        continue;
+                    for(int to=0; to<64; ++to) {
+                        int rowChange = abs(rowOf(to) - rowOf(from)), colChange = abs(colOf(to) - colOf(from));
+                        if(to == from || (rowChange != 0 && colChange != 0 && rowChange != colChange))
+                            continue;
+                        empty += BoardBenchAccess::isPathEmpty(board, rowOf(from), colOf(from), rowOf(to), colOf(to));
+                        ++calls;
+                    }
+                }
+            }
+        }
+        sink = sink + empty;
+        return calls;
+    } });
+
+    benchmarks.push_back({ "isKingSafe", [&positions]() {
+        uint64_t calls = 0, safe = 0;
+        for(BenchPosition &position : positions) {
+            for(int color=0; color<2; ++color) {
+                safe += position.board.isKingSafe(color);
+                ++calls;
+            }
+        }
+        sink = sink + safe;
+        return calls;
+    } });
+
+    benchmarks.push_back({ "isPieceSafe", [&positions]() {
+        uint64_t calls = 0, safe = 0;
+        for(BenchPosition &position : positions) {
+            const Board &board = position.board;
+            for(int color=0; color<2; ++color) {
+                for(int i=0; i<board.getPieceCount(color); ++i) {
+                    int square = board.getPieceSquare(color, i);
+                    safe += BoardBenchAccess::isPieceSafe(board, rowOf(square), colOf(square), color);
+                    ++calls;
+                }
+            }
+        }
+        sink = sink + safe;
+        return calls;
+    } });
+
+    benchmarks.push_back({ "calculateScore", [&positions]() {
+        uint64_t calls = 0;
+        double total = 0;
+        for(BenchPosition &position : positions) {
+            for(int color=0; color<2; ++color) {
+                total += BoardBenchAccess::calculateScore(position.board, color);
+                ++calls;
+            }
+        }
+        sink = sink + static_cast<uint64_t>(total);
+        return calls;
+    } });
+
+    // Without a transposition table, so every call tries the moves
+    benchmarks.push_back({ "isCheckmate", [&positions]() {
+        uint64_t calls = 0, total = 0;
+        for(BenchPosition &position : positions) {
+            total += position.board.isCheckmate(position.board.getSideToMove()) + 2;
+            ++calls;
+        }
+        sink = sink + total;
+        return calls;
+    } });
+
+    benchmarks.push_back({ "gameStatus", [&positions]() {
+        uint64_t calls = 0, total = 0;
+        for(BenchPosition &position : positions) {
+            total += static_cast<uint64_t>(position.board.gameStatus(position.board.getSideToMove()));
+            ++calls;
+        }
+        sink = sink + total;
+        return calls;
+    } });
+
+    // A fixed depth search from an empty transposition table, so every call does the same work. Each position has a
+    // search with a small table of its own, the tables are cleared before the pass outside the timing, so neither the
+    // clearing nor the table size shows up as time of suggestMove. The suggestion it prints is thrown away.
+    vector<std::unique_ptr<Search> > searches;
+    for(size_t i=0; i<positions.size(); ++i) {
+        searches.push_back(std::unique_ptr<Search>(new Search()));
+        searches.back()->setHashSize(SUGGEST_HASH_SIZE);
+    }
+    SearchLimits limits;
+    limits.depth = SUGGEST_DEPTH;
+    benchmarks.push_back({ "suggestMove", [&positions, &searches, &limits]() {
+        std::ostringstream discard;
+        std::streambuf *coutBuffer = cout.rdbuf(discard.rdbuf());
+        uint64_t calls = 0;
+        for(size_t i=0; i<positions.size(); ++i) {
+            positions[i].board.suggestMove(positions[i].board.getSideToMove(), *searches[i], limits);
+            ++calls;
+        }
+        cout.rdbuf(coutBuffer);
+        return calls;
+    }, [&searches]() {
+        for(std::unique_ptr<Search> &search : searches)
+            search->clearHash();
+    } });
+
+    bool jsonOnly = jsonFile == "-";
+    if(!jsonOnly)
+        cout << positions.size() << " positions, " << samples << " samples of each function" << endl;
+
+    vector<BenchResult> results;
+    for(const Benchmark &benchmark : benchmarks)
+        results.push_back(run(benchmark, samples));
+
+    if(jsonOnly) {
+        printJson(results, positions, samples, cout);
+        return 0;
+    }
+
+    printTable(results, cout);
+    if(!jsonFile.empty()) {
+        ofstream output(jsonFile.c_str());
+        if(!output.is_open()) {
+            cout << "Can't write to " << jsonFile << endl;
+            return 1;
+        }
+        printJson(results, positions, samples, output);
+        cout << "Results written to " << jsonFile << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,78 @@
+/* Multi-threaded search benchmark: measures the time to reach a fixed depth with 1, 2, 4... threads.
+ * Each thread count searches the same positions with an empty transposition table, the speedup is the time of one
+ * thread divided by the time of the thread count.
+ *
+ * Usage:
+ *   bench_smp [depth] [threads]    depth defaults to 6, threads to the number of cores of the machine */
+
+#include <chrono>
+#include <iomanip>
+#include <thread>
+#include "Board.h"
+#include "Search.h"
+
+namespace {
+    // Opening, middlegame and endgame positions
+    const char *benchPositions[] = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    };
+
+    // Searches every position to the depth with the thread count, returns the total seconds and adds up the nodes
+    double timeToDepth(int depth, int threads, uint64_t &nodes) {
+        Search search;
+        search.setThreads(threads);
+
+        SearchLimits limits;
+        limits.depth = depth;
+
+        double seconds = 0;
+        nodes = 0;
+        for(const char *fen : benchPositions) {
+            Board board;
+            board.setFromFen(fen);
+            search.clearHash();
+
+            SearchResult result = search.think(board, limits);
+            seconds += result.seconds;
+            nodes += result.nodes;
+        }
+        return seconds;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int depth = argc > 1 ? atoi(argv[1]) : 6;
+    int maxThreads = argc > 2 ? atoi(argv[2]) : static_cast<int>(std::thread::hardware_concurrency());
+    if(depth < 1)
+        depth = 6;
+    if(maxThreads < 1)
+        maxThreads = 1;
+
+    cout << "Time to depth " << depth << " (" << sizeof(benchPositions) / sizeof(benchPositions[0]) << " positions)" << endl;
+    cout << std::setw(8) << "threads" << std::setw(12) << "seconds" << std::setw(10) << "speedup"
+         << std::setw(14) << "nodes" << std::setw(14) << "nodes/s" << endl;
+
+    // 1, 2, 4, 8... threads, and the maximum itself if it is not a power of two
+    double oneThreadSeconds = 0;
+    for(int threads=1; ; threads *= 2) {
+        if(threads > maxThreads)
+            threads = maxThreads;
+
+        uint64_t nodes = 0;
+        double seconds = timeToDepth(depth, threads, nodes);
+        if(threads == 1)
+            oneThreadSeconds = seconds;
+
+        cout << std::setw(8) << threads << std::setw(12) << std::fixed << std::setprecision(3) << seconds
+             << std::setw(10) << std::setprecision(2) << (seconds > 0 ? oneThreadSeconds / seconds : 0)
+             << std::setw(14) << nodes << std::setw(14) << static_cast<uint64_t>(seconds > 0 ? nodes / seconds : 0) << endl;
+
+        if(threads == maxThreads)
+            break;
+    }
+
+    return 0;
+}
@@ -0,0 +1,230 @@
+/* Opening book builder: plays through a file of games and writes the moves of their first plies as a book file
+ * (see OpeningBook.h).
+ * The games are a PGN file (tags like [Result "1-0"] and [FEN "..."], moves in standard algebraic notation, comments
+ * and variations are skipped), or a text file with one game per line in coordinate or algebraic notation.
+ * A move gets 2 points of weight for each game its side won, 1 for a draw or an unknown result and 0 for a loss,
+ * so the book prefers the moves that did well.
+ *
+ * Usage:
+ *   build_book <games> <book> [plies] [min games]
+ *     plies      how many plies of each game go into the book (20 if not given)
+ *     min games  moves played in fewer games are left out (1 if not given) */
+
+#include <algorithm>
+#include <map>
+#include <utility>
+#include "OpeningBook.h"
+
+using std::cerr;
+
+namespace {
+    const string startFen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+    // Score of a game from white's view: 2 white won, 0 black won, 1 draw or unknown
+    const int WHITE_WON = 2, UNKNOWN = 1, BLACK_WON = 0;
+
+    struct MoveStats {
+        uint32_t weight;
+        uint32_t games;
+    };
+
+    // Moves of every position played so far, by key and encoded move
+    typedef std::map<std::pair<uint64_t, uint16_t>, MoveStats> BookMoves;
+
+    // A game read from the file: its starting position, its moves and its result
+    struct Game {
+        string fen;
+        vector<string> moves;
+        int result;
+
+        Game() : fen(startFen), result(UNKNOWN) {}
+    };
+
+    int resultOf(const string &token) {
+        if(token == "1-0") return WHITE_WON;
+        if(token == "0-1") return BLACK_WON;
+        return UNKNOWN;
+    }
+
+    bool isResult(const string &token) {
+        return token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*";
+    }
+
+    // Adds the tokens of a line of moves to the game, returns true if the line ends the game with a result.
+    // Comments in braces and variations in parentheses can go over several lines, their depth is kept in the counters.
+    bool readMoves(const string &line, Game &game, int &commentDepth, int &variationDepth) {
+        string token;
+        bool finished = false;
+
+        // Takes the token that ended at a space or a bracket
+        auto takeToken = [&]() {
+            if(!token.empty() && variationDepth == 0 && !finished) {
+                // Move numbers (12. or 12...) can be stuck to the move, annotations ($1) are skipped
+                size_t start = token.find_first_not_of("0123456789.");
+                if(isResult(token)) {
+                    game.result = resultOf(token);
+                    finished = true;
+                } else if(token[0] != '$' && start != string::npos) {
+                    game.moves.push_back(token.substr(start));
+                }
+            }
+            token.clear();
+        };
+
+        for(size_t i=0; i<line.size() && !finished; ++i) {
+            char c = line[i];
+
+            if(commentDepth > 0) {
+                if(c == '}')
+                    --commentDepth;
+                continue;
+            }
+            // The rest of the line is a comment
+            if(c == ';')
+                break;
+
+            if(c == '{' || c == '(' || c == ')' || isspace(static_cast<unsigned char>(c))) {
+                takeToken();
+                if(c == '{')
+                    ++commentDepth;
+                else if(c == '(')
+                    ++variationDepth;
+                else if(c == ')' && variationDepth > 0)
+                    --variationDepth;
+            } else {
+                token += c;
+            }
+        }
+        takeToken();
+        return finished;
+    }
+
+    // Plays the game's first plies and adds its moves to the book, returns false if a move can't be played
+    bool addGame(const Game &game, int plies, BookMoves &bookMoves) {
+        Board board;
+        if(!board.setFromFen(game.fen))
+            return false;
+
+        for(int ply=0; ply < plies && ply < static_cast<int>(game.moves.size()); ++ply) {
+            Move move;
+            if(!board.parseMove(game.moves[ply], move)) {
+                cerr << "Can't play " << game.moves[ply] << " in " << board.toFen() << "\n";
+                return false;
+            }
+
+            // The side that won gets all the points, white's score is turned around for black
+            int score = board.getSideToMove() == 0 ? game.result : 2 - game.result;
+            MoveStats &stats = bookMoves[std::make_pair(board.getHashKey(), OpeningBook::encodeMove(move))];
+            stats.weight += score;
+            stats.games += 1;
+
+            board.makeMove(move);
+        }
+        return true;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if(argc < 3) {
+        cerr << "Usage: build_book <games> <book> [plies] [min games]\n";
+        return 1;
+    }
+    int plies = argc > 3 ? atoi(argv[3]) : 20;
+    uint32_t minGames = argc > 4 ? static_cast<uint32_t>(atoi(argv[4])) : 1;
+
+    ifstream input(argv[1]);
+    if(!input.is_open()) {
+        cerr << "Can't read " << argv[1] << "\n";
+        return 1;
+    }
+
+    // A PGN file has tag lines, otherwise every line is a game
+    vector<string> lines;
+    bool pgn = false;
+    string line;
+    while(getline(input, line)) {
+        if(!line.empty() && line.back() == '\r')
+            line.pop_back();
+        pgn = pgn || (!line.empty() && line[0] == '[');
+        lines.push_back(line);
+    }
+
+    BookMoves bookMoves;
+    int games = 0, skipped = 0;
+    Game game;
+    int commentDepth = 0, variationDepth = 0;
+    bool inMoves = false;
+
+    auto finishGame = [&]() {
+        if(!game.moves.empty()) {
+            if(addGame(game, plies, bookMoves))
+                ++games;
+            else
+                ++skipped;
+        }
+        game = Game();
+        commentDepth = variationDepth = 0;
+        inMoves = false;
+    };
+
+    for(const string &text : lines) {
+        if(pgn && commentDepth == 0 && !text.empty() && text[0] == '[') {
+            // Tags after moves start the next game (the last one had no result)
+            if(inMoves)
+                finishGame();
+
+            size_t quote = text.find('"');
+            size_t endQuote = text.rfind('"');
+            if(quote == string::npos || endQuote <= quote)
+                continue;
+            string value = text.substr(quote + 1, endQuote - quote - 1);
+            if(text.compare(0, 5, "[FEN ") == 0)
+                game.fen = value;
+            else if(text.compare(0, 8, "[Result ") == 0)
+                game.result = resultOf(value);
+            continue;
+        }
+
+        inMoves = true;
+        if(readMoves(text, game, commentDepth, variationDepth) || !pgn)
+            finishGame();
+    }
+    finishGame();
+
+    // Entries sorted by key, and the moves of a position from the most weight to the least
+    struct Entry {
+        uint64_t key;
+        uint16_t move;
+        uint32_t weight;
+    };
+    vector<Entry> entries;
+    uint32_t maxWeight = 0;
+    for(const BookMoves::value_type &bookMove : bookMoves) {
+        if(bookMove.second.games < minGames || bookMove.second.weight == 0)
+            continue;
+        entries.push_back({ bookMove.first.first, bookMove.first.second, bookMove.second.weight });
+        maxWeight = std::max(maxWeight, bookMove.second.weight);
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+        return a.key != b.key ? a.key < b.key : a.weight > b.weight;
+    });
+
+    // Weights have 16 bits in the file, bigger ones are scaled down together
+    vector<unsigned char> book(entries.size() * OpeningBook::ENTRY_SIZE);
+    for(size_t i=0; i<entries.size(); ++i) {
+        uint32_t weight = maxWeight > 65535 ? static_cast<uint32_t>(uint64_t(entries[i].weight) * 65535 / maxWeight) : entries[i].weight;
+        OpeningBook::writeEntry(&book[i * OpeningBook::ENTRY_SIZE], entries[i].key, entries[i].move,
+                                static_cast<uint16_t>(weight > 0 ? weight : 1));
+    }
+
+    ofstream output(argv[2], std::ios::binary);
+    output.write(reinterpret_cast<const char *>(book.data()), book.size());
+    if(!output.good()) {
+        cerr << "Can't write " << argv[2] << "\n";
+        return 1;
+    }
+
+    cout << games << " games read, " << skipped << " skipped (a move could not be played), " << entries.size()
+         << " book entries written to " << argv[2] << endl;
+    return 0;
+}
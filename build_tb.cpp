@@ -0,0 +1,58 @@
+/* Tablebase generator: builds endgame tables (see Tablebase.h) and writes them to a directory, where the game can load
+ * them with --tb <directory>.
+ *
+ * Usage:
+ *   build_tb <directory> [threads] [tables...]
+ *     threads  threads that build each table (the number of cores if not given or 0)
+ *     tables   names like KQvK or KBNK, the tables they need are built too. Without names every table of 3 men is
+ *              built with KBNvK and KQvKR. "all" builds every table up to 4 men (about 2 GB of memory at the end). */
+
+#include <thread>
+#include "Tablebase.h"
+
+using std::cerr;
+
+int main(int argc, char *argv[]) {
+    if(argc < 2) {
+        cerr << "Usage: build_tb <directory> [threads] [tables...]\n";
+        return 1;
+    }
+    string directory = argv[1];
+    int threads = argc > 2 ? atoi(argv[2]) : 0;
+    if(threads < 1)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    vector<string> names;
+    for(int i=3; i<argc; ++i)
+        names.push_back(argv[i]);
+    if(names.empty())
+        names = { "KQvK", "KRvK", "KBvK", "KNvK", "KPvK", "KBNvK", "KQvKR" };
+
+    // Every set of up to two pieces besides the Kings
+    if(names.size() == 1 && names[0] == "all") {
+        names.clear();
+        const string letters = "QRBNP";
+        for(char first : letters) {
+            names.push_back(string("K") + first + "vK");
+            for(char second : letters) {
+                names.push_back(string("K") + first + second + "vK");
+                names.push_back(string("K") + first + "vK" + second);
+            }
+        }
+    }
+
+    Tablebases tablebases;
+    for(const string &name : names) {
+        if(!tablebases.generate(name, threads, &cout)) {
+            cerr << name << " is not a set of pieces with up to " << Tablebases::MAX_MEN << " men\n";
+            return 1;
+        }
+    }
+
+    if(!tablebases.save(directory)) {
+        cerr << "Can't write the tables to " << directory << "\n";
+        return 1;
+    }
+    cout << tablebases.getNames().size() << " tables written to " << directory << endl;
+    return 0;
+}
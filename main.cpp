@@ -2,25 +2,113 @@
 using namespace std;
 
 #include "Board.h"
+#include <fstream>
+#include "Batch.h"
+#include "OpeningBook.h"
+#include "Ponder.h"
+#include "Search.h"
+#include "Tablebase.h"
+#include "Uci.h"
+
+int main(int argc, char *argv[]) {
+    // --uci starts the UCI mode for chess GUIs instead of the game, the options are given with setoption there
+    for(int i=1; i<argc; ++i) {
+        if(string(argv[i]) == "--uci") {
+            Uci uci;
+            return uci.run();
+        }
+    }
 
-int main() {
     Board chess;
+    Search search;
     string input;
 
+    // Budget of a move suggestion: one second, unless --movetime <milliseconds>, --depth <plies> or --nodes <count> is given.
+    // --hash <megabytes> changes the size of the transposition table, --threads <count> searches with more threads.
+    // --batch <path> (can be given more than once) analyzes the positions of the path instead of starting the game, with
+    // --jobs <count> positions at the same time and the results written to --output <file> (or printed), see Batch.h.
+    // --book <file> suggests the moves of the opening book (see OpeningBook.h) while the position is in it.
+    // --tb <directory> loads the endgame tables of the directory (see Tablebase.h, built with build_tb).
+    // --stats on prints the statistics of the search (nodes, transposition table hits...) after each suggestion.
+    // --ponder off stops the search in the background while the program waits for input (see Ponder.h).
+    SearchLimits suggestLimits;
+    OpeningBook book;
+    Tablebases tablebases;
+    bool pondering = true;
+    BatchOptions batch;
+    string batchOutput;
+    for(int i=1; i+1<argc; i+=2) {
+        string option = argv[i];
+        if(option == "--movetime")
+            suggestLimits.moveTime = atoi(argv[i + 1]);
+        else if(option == "--depth")
+            suggestLimits.depth = atoi(argv[i + 1]);
+        else if(option == "--nodes")
+            suggestLimits.nodes = strtoull(argv[i + 1], nullptr, 10);
+        else if(option == "--hash") {
+            search.setHashSize(atoi(argv[i + 1]));
+            batch.hashSize = atoi(argv[i + 1]);
+        }
+        else if(option == "--threads")
+            search.setThreads(atoi(argv[i + 1]));
+        else if(option == "--batch")
+            batch.paths.push_back(argv[i + 1]);
+        else if(option == "--jobs")
+            batch.jobs = atoi(argv[i + 1]);
+        else if(option == "--output")
+            batchOutput = argv[i + 1];
+        else if(option == "--book" && !book.open(argv[i + 1]))
+            cout << "Can't open the opening book " << argv[i + 1] << ", moves will be searched.\n";
+        else if(option == "--tb") {
+            if(tablebases.load(argv[i + 1]) == 0)
+                cout << "No endgame tables in " << argv[i + 1] << ", endgames will be searched.\n";
+            search.setTablebases(&tablebases);
+            batch.tablebases = &tablebases;
+        }
+        else if(option == "--stats")
+            search.setStatsEnabled(string(argv[i + 1]) == "on");
+        else if(option == "--ponder")
+            pondering = string(argv[i + 1]) != "off";
+    }
+    if(suggestLimits.moveTime <= 0 && suggestLimits.depth <= 0 && suggestLimits.nodes == 0)
+        suggestLimits.moveTime = 1000;
+
+    if(!batch.paths.empty()) {
+        batch.limits = suggestLimits;
+        batch.threadsPerSearch = search.getThreads();
+        if(batchOutput.empty())
+            return runBatch(batch, cout) ? 0 : 1;
+
+        ofstream outputStream(batchOutput.c_str());
+        if(!outputStream.is_open()) {
+            cout << "Can't write to " << batchOutput << "\n";
+            return 1;
+        }
+        return runBatch(batch, outputStream) ? 0 : 1;
+    }
+
     cout << "***           Welcome to Chess!           ***\n"
     << "- There are some options available to perform:\n"
     << "- Enter your move in standard form (ex: e2e4)\n"
     << "- Type 'suggest' to receive a move suggestion\n"
     << "- Type 'save' to save the current state of the board into a file\n"
     << "- Type 'load' to load a previously saved board file to this game\n"
+    << "- Type 'undo' to take back the last move\n"
     << "- Type 'exit' to end the game and exit the program.\n\n";
 
     chess.printBoard();
 
     int old_row=0, old_col=0, new_row=0, new_col=0;
+    PieceType promotion = PieceType::Queen;
     int attempts = 1;
     int turnColor = 0; // Holds 0 for white's turn, 1 for black's turn
     int kingSafe = 1; // King starts as safe
+    GameStatus status = GameStatus::Ongoing; // Checkmate or stalemate end the game
+
+    // The position is searched while the player types, the search is stopped as soon as the input is read
+    Ponder ponder(search);
+    SearchResult pondered;
+    bool hasPondered = false;
 
     do {
         cout << (turnColor == 0 ? "[White's turn]\n" : "[Black's turn]\n");
@@ -36,12 +124,15 @@ int main() {
         }
 
         cout << "Enter your move: ";
+        if(pondering)
+            ponder.start(chess);
         getline(cin, input);
-        int inputResult = chess.inputMove(input, old_row, old_col, new_row, new_col, turnColor);
+        hasPondered = ponder.stop(pondered);
+        int inputResult = chess.inputMove(input, old_row, old_col, new_row, new_col, turnColor, promotion);
 
         // Call specified functions according to the inputMove's return value (you can read more about that function's declaration)
         if(inputResult == 2) {
-            chess.suggestMove(turnColor);
+            chess.suggestMove(turnColor, search, suggestLimits, &book, hasPondered ? &pondered : nullptr);
         } else if(inputResult == 3) {
             chess.saveToFile(turnColor);
         } else if(inputResult == 4) {
@@ -49,6 +140,15 @@ int main() {
             if(loadResult != -1) {
                 // Change the current turn to the one saved on the saved board
                 turnColor = loadResult; 
+                // The saved game may be in check, or already over
+                kingSafe = chess.isKingSafe(turnColor);
+                status = chess.gameStatus(turnColor);
+            }
+        } else if(inputResult == 5) {
+            if(chess.revertMove()) {
+                // The player who made the taken back move plays again
+                turnColor = (turnColor == 0 ? 1 : 0);
+                kingSafe = chess.isKingSafe(turnColor);
             }
         }
         else if(inputResult == -1) {
@@ -73,18 +173,28 @@ int main() {
                 }
 
                 cout << "Enter your move: ";
+                if(pondering)
+                    ponder.start(chess);
                 getline(cin, input);
-                inputResult = chess.inputMove(input, old_row, old_col, new_row, new_col, turnColor);
+                hasPondered = ponder.stop(pondered);
+                inputResult = chess.inputMove(input, old_row, old_col, new_row, new_col, turnColor, promotion);
 
                 // Call specified functions according to the inputMove's return value (you can read more about that function's declaration)
                 if(inputResult == 2) {
-                    chess.suggestMove(turnColor);
+                    chess.suggestMove(turnColor, search, suggestLimits, &book, hasPondered ? &pondered : nullptr);
                 } else if(inputResult == 3) {
                     chess.saveToFile(turnColor);
                 } else if(inputResult == 4) {
                     int loadResult = chess.loadFromFile();
                     if(loadResult != -1) {
                         turnColor = loadResult; 
+                        kingSafe = chess.isKingSafe(turnColor);
+                        status = chess.gameStatus(turnColor);
+                    }
+                } else if(inputResult == 5) {
+                    if(chess.revertMove()) {
+                        turnColor = (turnColor == 0 ? 1 : 0);
+                        kingSafe = chess.isKingSafe(turnColor);
                     }
                 }
                 else if(inputResult == -1) {
@@ -100,33 +210,30 @@ int main() {
         attempts = 1;
 
 
-        // Input is valid, try to make the move to see if it's a legal chess move
-        if (inputResult == 1 && chess.movePiece(old_row, old_col, new_row, new_col)) {
-            if (chess.isKingSafe(turnColor) == 0) {
-                // This move puts the King in danger, don't allow it
-                cout << "Move not allowed! Check your King's surroundings.\n";
-                chess.revertMove(); // Only revert the move, the turn will not change so don't revert the turn.
-            } else {
-                // Change the turn from 0 to 1 or from 1 to 0, if the entered move was legal.
-                turnColor = (turnColor == 0 ? 1 : 0);
+        // Input is valid, try to make the move to see if it's a legal chess move (movePiece doesn't make a move that
+        // puts the King in danger)
+        if (inputResult == 1 && chess.movePiece(old_row, old_col, new_row, new_col, promotion)) {
+            // Change the turn from 0 to 1 or from 1 to 0, if the entered move was legal.
+            turnColor = (turnColor == 0 ? 1 : 0);
 
-                // Check if the King of the opponent is safe
-                kingSafe = chess.isKingSafe(turnColor);
+            // Check if the King of the opponent is safe
+            kingSafe = chess.isKingSafe(turnColor);
 
-                // Check for checkmate (only if the King is not safe)
-                if (kingSafe == 0) {
-                    kingSafe = chess.isCheckmate(turnColor);
-                }
-            }
-        } else if(inputResult != 2 && inputResult != 3 && inputResult != 4) {
+            // The opponent has to have a legal move to go on: checkmate if its King is attacked, stalemate otherwise
+            status = chess.gameStatus(turnColor);
+        } else if(inputResult != 2 && inputResult != 3 && inputResult != 4 && inputResult != 5) {
             // Not a legal chess move and the other functions were not called either.
-            cout << "Invalid move, please try again.\n\n";
+            cout << "Invalid move, please try again. A move can't leave your King in danger.\n\n";
         }
 
         // Print the board after each move
         chess.printBoard();
 
-    } while(kingSafe != -1); // -1 is returned when it's checkmate
-    cout << "\nCheckmate! " << ((turnColor==0) ? "Black" : "White") << " player won the game.\n";
+    } while(status == GameStatus::Ongoing);
+
+    if(status == GameStatus::Stalemate)
+        cout << "\nStalemate! " << ((turnColor==0) ? "White" : "Black") << " player has no legal move, the game is a draw.\n";
+    else
+        cout << "\nCheckmate! " << ((turnColor==0) ? "Black" : "White") << " player won the game.\n";
     return 0;
 }
\ No newline at end of file
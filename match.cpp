@@ -0,0 +1,747 @@
+/* Self-play match: plays games between two engine configurations, several games at the same time, and reports the
+ * result as an Elo difference with its error margin, the nodes per second of each engine and (if asked) an SPRT
+ * verdict, so a change can be tested for strength and not only for speed.
+ *
+ * An engine is this build in the same process, with its own options, or any other build (or UCI engine) run as a
+ * separate process. Every game has its own Board, and every running game its own engines (searches, transposition
+ * tables, books), nothing is shared between the games but the endgame tables, which are only read.
+ * Each opening is played twice, with the colors swapped. A game ends with checkmate, stalemate, the fifty-move rule,
+ * threefold repetition, insufficient material, a lost time, an illegal move, or a draw after the most plies.
+ *
+ * Usage:
+ *   match [options]
+ *     --engine1 <spec>, --engine2 <spec>   the two engines, the results are from engine1's view (default: self)
+ *          self[:option=value,...]         this build, options: hash (megabytes), threads, book (file), tb (directory),
+ *                                          depth, nodes (a limit on top of the time)
+ *          any other text                  a command line that starts a UCI engine, like "/path/to/old/output --uci"
+ *     --games <count>          games to play (default 100)
+ *     --concurrency <count>    games played at the same time (default the number of cores)
+ *     --tc <ms>[+<ms>]         time of each side for the game and increment per move (default 10000+100)
+ *     --movetime <ms>          a fixed time for each move instead of the clock
+ *     --openings <file>        FEN or EPD positions to start the games from, one per line (default a built-in set)
+ *     --sprt <elo0>,<elo1>     sequential test of engine1 being elo1 stronger (H1) against elo0 (H0), the match stops as
+ *                              soon as one is accepted. --alpha and --beta set the error rates (default 0.05).
+ *     --maxplies <count>       a game that gets this long is a draw (default 400) */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "OpeningBook.h"
+#include "Search.h"
+#include "Tablebase.h"
+
+using std::cerr;
+
+namespace {
+    // Balanced positions a few moves into common openings
+    const char *defaultOpenings[] = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3",
+        "rnbqkbnr/pp1ppppp/8/2p5/4P3/8/PPPP1PPP/RNBQKBNR w KQkq c6 0 2",
+        "rnbqkbnr/pppp1ppp/4p3/8/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - 0 2",
+        "rnbqkbnr/pp1ppppp/2p5/8/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - 0 2",
+        "rnbqkb1r/pppppppp/5n2/8/3P4/8/PPP1PPPP/RNBQKBNR w KQkq - 1 2",
+        "rnbqkbnr/ppp1pppp/8/3p4/2PP4/8/PP2PPPP/RNBQKBNR b KQkq c3 0 2",
+        "rnbqkb1r/pppppp1p/5np1/8/2PP4/8/PP2PPPP/RNBQKBNR w KQkq - 0 3",
+        "rnbqkbnr/pppppppp/8/8/2P5/8/PP1PPPPP/RNBQKBNR b KQkq c3 0 1",
+        "rnbqkbnr/pppppppp/8/8/8/5N2/PPPPPPPP/RNBQKB1R b KQkq - 1 1",
+        "r1bqkbnr/pppp1ppp/2n5/1B2p3/4P3/5N2/PPPP1PPP/RNBQK2R b KQkq - 3 3",
+        "rnbqkb1r/pp2pppp/3p1n2/8/3NP3/8/PPP2PPP/RNBQKB1R w KQkq - 1 5",
+    };
+
+    // A move that comes this many milliseconds after the time is up (the clock, or the move time) loses on time. An
+    // engine in a separate process is not waited for any longer than that: it is killed and started again.
+    const int TIME_MARGIN = 1000;
+    // Longest wait for the answers of a separate engine that are not moves (uciok, readyok)
+    const int ANSWER_TIMEOUT = 10000;
+
+    typedef std::chrono::steady_clock Clock;
+
+    // Time of each side, or a fixed time per move if moveTime is not 0. In milliseconds.
+    struct TimeControl {
+        int time;
+        int increment;
+        int moveTime;
+    };
+
+    // Options of an engine of this build
+    struct SelfOptions {
+        int hashSize;
+        int threads;
+        string book;
+        const Tablebases *tablebases;
+        int depth;
+        uint64_t nodes;
+
+        SelfOptions() : hashSize(16), threads(1), tablebases(nullptr), depth(0), nodes(0) {}
+    };
+
+    // What an engine spec describes: this build with options, or the command line of another engine
+    struct EngineSpec {
+        string name;
+        bool self;
+        SelfOptions options;
+        string command;
+    };
+
+    // A player of the games. One player plays one game at a time.
+    class Player {
+    public:
+        virtual ~Player() {}
+
+        // Returns false if the engine can't be used (a process that didn't start)
+        virtual bool start() { return true; }
+
+        // Called before every game
+        virtual void newGame() = 0;
+
+        // Finds the move of the side to move. The position is the opening's FEN and the moves played from it, the
+        // board is that position. timeLeft is the clock of each color (unused with a fixed time per move).
+        // Returns false if the engine gave no move. nodes is set to the nodes it searched.
+        virtual bool findMove(const Board &board, const string &fen, const vector<Move> &moves,
+                              const TimeControl &timeControl, const int timeLeft[2], Move &move, uint64_t &nodes) = 0;
+    };
+
+    class SelfPlayer : public Player {
+    public:
+        explicit SelfPlayer(const SelfOptions &options) : options(options) {
+            search.setHashSize(options.hashSize);
+            search.setThreads(options.threads);
+            search.setTablebases(options.tablebases);
+            if(!options.book.empty())
+                book.open(options.book);
+        }
+
+        void newGame() override {
+            search.clearHash();
+        }
+
+        bool findMove(const Board &board, const string &, const vector<Move> &, const TimeControl &timeControl,
+                      const int timeLeft[2], Move &move, uint64_t &nodes) override {
+            Board position = board;
+            nodes = 0;
+            if(book.isOpen() && book.pickMove(position, move))
+                return true;
+
+            SearchLimits limits;
+            int color = position.getSideToMove();
+            limits.moveTime = timeControl.moveTime > 0 ? timeControl.moveTime
+                              : moveTimeFromClock(timeLeft[color], timeControl.increment, 0);
+            limits.depth = options.depth;
+            limits.nodes = options.nodes;
+
+            SearchResult result = search.think(position, limits);
+            nodes = result.nodes;
+            move = result.bestMove;
+            return move.from != move.to;
+        }
+
+    private:
+        SelfOptions options;
+        Search search;
+        OpeningBook book;
+    };
+
+    // An engine in a separate process, spoken to over pipes with the UCI protocol. Its answers are read with a deadline,
+    // an engine that hangs or never gives its move is killed and started again for the next move or game.
+    class UciPlayer : public Player {
+    public:
+        explicit UciPlayer(const string &command) : command(command), pid(-1), input(-1), output(nullptr) {}
+
+        ~UciPlayer() override {
+            stopEngine();
+        }
+
+        bool start() override {
+            int toEngine[2], fromEngine[2];
+            if(pipe(toEngine) != 0)
+                return false;
+            if(pipe(fromEngine) != 0) {
+                close(toEngine[0]);
+                close(toEngine[1]);
+                return false;
+            }
+
+            pid = fork();
+            if(pid < 0) {
+                close(toEngine[0]);
+                close(toEngine[1]);
+                close(fromEngine[0]);
+                close(fromEngine[1]);
+                return false;
+            }
+            if(pid == 0) {
+                // The engine reads the commands from its standard input and answers on its standard output. It gets a
+                // process group of its own, so killing the group also ends what the shell started.
+                setpgid(0, 0);
+                dup2(toEngine[0], STDIN_FILENO);
+                dup2(fromEngine[1], STDOUT_FILENO);
+                close(toEngine[0]);
+                close(toEngine[1]);
+                close(fromEngine[0]);
+                close(fromEngine[1]);
+                execl("/bin/sh", "sh", "-c", command.c_str(), static_cast<char *>(nullptr));
+                _exit(127);
+            }
+
+            close(toEngine[0]);
+            close(fromEngine[1]);
+            input = fromEngine[0];
+            output = fdopen(toEngine[1], "w");
+            if(output == nullptr) {
+                close(toEngine[1]);
+                stopEngine();
+                return false;
+            }
+
+            send("uci");
+            if(waitFor("uciok", deadlineIn(ANSWER_TIMEOUT)) && ready())
+                return true;
+            stopEngine();
+            return false;
+        }
+
+        void newGame() override {
+            // An engine that didn't start again after a lost move gets another chance at every game
+            if(output == nullptr && !start())
+                return;
+            send("ucinewgame");
+            if(!ready())
+                restart();
+        }
+
+        bool findMove(const Board &board, const string &fen, const vector<Move> &moves, const TimeControl &timeControl,
+                      const int timeLeft[2], Move &move, uint64_t &nodes) override {
+            nodes = 0;
+            if(output == nullptr)
+                return false;
+
+            string position = "position fen " + fen;
+            if(!moves.empty()) {
+                position += " moves";
+                for(const Move &played : moves)
+                    position += " " + moveToString(played);
+            }
+            send(position);
+
+            int budget;
+            if(timeControl.moveTime > 0) {
+                budget = timeControl.moveTime;
+                send("go movetime " + std::to_string(timeControl.moveTime));
+            } else {
+                budget = timeLeft[board.getSideToMove()];
+                send("go wtime " + std::to_string(timeLeft[0]) + " btime " + std::to_string(timeLeft[1])
+                     + " winc " + std::to_string(timeControl.increment) + " binc "
+                     + std::to_string(timeControl.increment));
+            }
+
+            // The nodes of the last info line before the best move are the nodes of the search
+            Clock::time_point deadline = deadlineIn(budget + TIME_MARGIN);
+            string line;
+            while(readLine(line, deadline)) {
+                std::istringstream words(line);
+                string word;
+                words >> word;
+                if(word == "info") {
+                    while(words >> word) {
+                        if(word == "nodes")
+                            words >> nodes;
+                    }
+                } else if(word == "bestmove") {
+                    string notation;
+                    words >> notation;
+                    Board copy = board;
+                    return copy.parseMove(notation, move);
+                }
+            }
+            // The engine exited or is still thinking after its time, it can't be trusted with the next position
+            restart();
+            return false;
+        }
+
+    private:
+        static Clock::time_point deadlineIn(int milliseconds) {
+            return Clock::now() + std::chrono::milliseconds(milliseconds);
+        }
+
+        void send(const string &line) {
+            fprintf(output, "%s\n", line.c_str());
+            fflush(output);
+        }
+
+        // Gives the next line of the engine. Returns false if the engine exited or the deadline passed first.
+        bool readLine(string &line, Clock::time_point deadline) {
+            while(true) {
+                size_t end = buffered.find('\n');
+                if(end != string::npos) {
+                    line = buffered.substr(0, end);
+                    buffered.erase(0, end + 1);
+                    if(!line.empty() && line.back() == '\r')
+                        line.pop_back();
+                    return true;
+                }
+
+                auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+                if(wait <= 0)
+                    return false;
+                pollfd request = { input, POLLIN, 0 };
+                int ready = poll(&request, 1, static_cast<int>(wait));
+                if(ready < 0 && errno == EINTR)
+                    continue;
+                if(ready <= 0)
+                    return false;
+
+                char chunk[4096];
+                ssize_t count = read(input, chunk, sizeof(chunk));
+                if(count <= 0)
+                    return false;
+                buffered.append(chunk, static_cast<size_t>(count));
+            }
+        }
+
+        bool waitFor(const string &answer, Clock::time_point deadline) {
+            string line;
+            while(readLine(line, deadline)) {
+                if(line == answer)
+                    return true;
+            }
+            return false;
+        }
+
+        bool ready() {
+            send("isready");
+            return waitFor("readyok", deadlineIn(ANSWER_TIMEOUT));
+        }
+
+        // Asks the engine to quit, kills it if it is still running a moment later, and closes the pipes
+        void stopEngine() {
+            if(output != nullptr) {
+                send("quit");
+                fclose(output);
+                output = nullptr;
+            }
+            if(input >= 0) {
+                close(input);
+                input = -1;
+            }
+            buffered.clear();
+            if(pid > 0) {
+                Clock::time_point deadline = deadlineIn(TIME_MARGIN);
+                while(waitpid(pid, nullptr, WNOHANG) == 0) {
+                    if(Clock::now() >= deadline) {
+                        kill(-pid, SIGKILL);
+                        waitpid(pid, nullptr, 0);
+                        break;
+                    }
+                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                }
+                pid = -1;
+            }
+        }
+
+        void restart() {
+            stopEngine();
+            if(!start())
+                cerr << "Can't start again: " << command << "\n";
+        }
+
+        string command;
+        pid_t pid;
+        int input;
+        FILE *output;
+        string buffered;    // Read from the engine but not a whole line yet
+    };
+
+    std::unique_ptr<Player> makePlayer(const EngineSpec &spec) {
+        if(spec.self)
+            return std::unique_ptr<Player>(new SelfPlayer(spec.options));
+        return std::unique_ptr<Player>(new UciPlayer(spec.command));
+    }
+
+    // Reads "self", "self:option=value,..." or a command line. Returns false for an unknown option.
+    bool parseEngineSpec(const string &text, const string &name, EngineSpec &spec,
+                         vector<std::unique_ptr<Tablebases> > &tablebases) {
+        spec.name = name;
+        spec.self = text == "self" || text.compare(0, 5, "self:") == 0;
+        if(!spec.self) {
+            spec.command = text;
+            return true;
+        }
+
+        std::istringstream options(text.length() > 5 ? text.substr(5) : string());
+        string option;
+        while(std::getline(options, option, ',')) {
+            size_t equals = option.find('=');
+            string key = option.substr(0, equals);
+            string value = equals == string::npos ? string() : option.substr(equals + 1);
+            if(key == "hash")
+                spec.options.hashSize = atoi(value.c_str());
+            else if(key == "threads")
+                spec.options.threads = atoi(value.c_str());
+            else if(key == "book")
+                spec.options.book = value;
+            else if(key == "depth")
+                spec.options.depth = atoi(value.c_str());
+            else if(key == "nodes")
+                spec.options.nodes = strtoull(value.c_str(), nullptr, 10);
+            else if(key == "tb") {
+                // Loaded once here, every game of the engine reads the same tables
+                tablebases.push_back(std::unique_ptr<Tablebases>(new Tablebases()));
+                if(tablebases.back()->load(value) == 0)
+                    cerr << "No endgame tables in " << value << "\n";
+                spec.options.tablebases = tablebases.back().get();
+            } else {
+                cerr << "Unknown engine option " << key << "\n";
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Neither side has enough pieces to checkmate: Kings alone, or a single Knight or Bishop with them
+    bool insufficientMaterial(const Board &board) {
+        int minorPieces = 0;
+        for(int square=0; square<64; ++square) {
+            PieceType type = board.getPiece(rowOf(square), colOf(square)).getType();
+            if(type == PieceType::Knight || type == PieceType::Bishop)
+                ++minorPieces;
+            else if(type != PieceType::King && type != PieceType::Empty)
+                return false;
+        }
+        return minorPieces <= 1;
+    }
+
+    struct GameResult {
+        int score;          // For engine1: 1 win, 0 draw, -1 loss
+        string reason;
+        uint64_t nodes[2];  // Of engine1 and engine2
+        double seconds[2];
+    };
+
+    // Plays one game from the FEN, players[0] is engine1 and players[1] engine2
+    GameResult playGame(Player *players[2], bool engine1White, const string &fen, const TimeControl &timeControl,
+                        int maxPlies) {
+        GameResult result = { 0, "", { 0, 0 }, { 0, 0 } };
+        Board board;
+        board.setFromFen(fen);
+        vector<Move> moves;
+        vector<uint64_t> keys(1, board.getHashKey());
+        int timeLeft[2] = { timeControl.time, timeControl.time };
+
+        players[0]->newGame();
+        players[1]->newGame();
+
+        // The engine of each color: 0 for engine1, 1 for engine2
+        int engineOf[2] = { engine1White ? 0 : 1, engine1White ? 1 : 0 };
+        while(true) {
+            int color = board.getSideToMove();
+
+            // The side to move loses (winner is the other one) or the game is drawn
+            int loser = -1;
+            GameStatus status = board.gameStatus(color);
+            if(status == GameStatus::Checkmate) {
+                loser = color;
+                result.reason = "checkmate";
+            } else if(status == GameStatus::Stalemate) {
+                result.reason = "stalemate";
+            } else if(board.getHalfmoveClock() >= 100) {
+                result.reason = "fifty moves";
+            } else if(std::count(keys.begin(), keys.end(), board.getHashKey()) >= 3) {
+                result.reason = "threefold repetition";
+            } else if(insufficientMaterial(board)) {
+                result.reason = "insufficient material";
+            } else if(static_cast<int>(moves.size()) >= maxPlies) {
+                result.reason = "too long";
+            }
+
+            int engine = engineOf[color];
+            if(result.reason.empty()) {
+                Move move;
+                uint64_t nodes = 0;
+                auto start = Clock::now();
+                bool found = players[engine]->findMove(board, fen, moves, timeControl, timeLeft, move, nodes);
+                double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+                result.nodes[engine] += nodes;
+                result.seconds[engine] += seconds;
+
+                // The time is checked first: an engine that was stopped for thinking too long has no move either
+                int elapsed = static_cast<int>(seconds * 1000);
+                if(timeControl.moveTime > 0 ? elapsed > timeControl.moveTime + TIME_MARGIN : elapsed > timeLeft[color]) {
+                    loser = color;
+                    result.reason = "time";
+                } else if(!found || !board.isPseudoLegal(move) || !board.isLegal(move)) {
+                    loser = color;
+                    result.reason = "illegal move";
+                } else if(timeControl.moveTime == 0) {
+                    timeLeft[color] += timeControl.increment - elapsed;
+                }
+
+                if(result.reason.empty()) {
+                    board.makeMove(move);
+                    moves.push_back(move);
+                    keys.push_back(board.getHashKey());
+                    continue;
+                }
+            }
+
+            if(loser >= 0)
+                result.score = engineOf[loser] == 0 ? -1 : 1;
+            return result;
+        }
+    }
+
+    // Elo difference of a score (0 to 1)
+    double eloOf(double score) {
+        score = std::min(std::max(score, 1e-6), 1 - 1e-6);
+        return -400.0 * std::log10(1.0 / score - 1.0);
+    }
+
+    double scoreOf(double elo) {
+        return 1.0 / (1.0 + std::pow(10.0, -elo / 400.0));
+    }
+
+    // Results of the games so far, from engine1's view
+    struct MatchState {
+        int wins, losses, draws;
+        uint64_t nodes[2];
+        double seconds[2];
+
+        MatchState() : wins(0), losses(0), draws(0), nodes{ 0, 0 }, seconds{ 0, 0 } {}
+
+        int games() const { return wins + losses + draws; }
+    };
+
+    // Log-likelihood ratio of the SPRT (H1: the Elo difference is elo1, H0: it is elo0), with the normal approximation
+    // of the trinomial results: LLR = N (s1 - s0) (2 mean - s0 - s1) / (2 variance)
+    double likelihoodRatio(const MatchState &state, double elo0, double elo1) {
+        int games = state.games();
+        if(games == 0 || state.wins + state.draws == 0 || state.losses + state.draws == 0)
+            return 0;
+        double mean = (state.wins + 0.5 * state.draws) / games;
+        double variance = (state.wins * (1 - mean) * (1 - mean) + state.losses * mean * mean
+                           + state.draws * (0.5 - mean) * (0.5 - mean)) / games;
+        if(variance <= 0)
+            return 0;
+        double s0 = scoreOf(elo0), s1 = scoreOf(elo1);
+        return games * (s1 - s0) * (2 * mean - s0 - s1) / (2 * variance);
+    }
+
+    void printSummary(const MatchState &state, const EngineSpec engines[2]) {
+        int games = state.games();
+        double score = games > 0 ? (state.wins + 0.5 * state.draws) / games : 0.5;
+        cout << "\nScore of " << engines[0].name << " vs " << engines[1].name << ": " << state.wins << " - "
+             << state.losses << " - " << state.draws << " [" << std::fixed << std::setprecision(3) << score << "] "
+             << games << " games" << endl;
+
+        if(games > 0) {
+            // 95% interval of the mean score, from the variance of the results of one game
+            double variance = (state.wins * (1 - score) * (1 - score) + state.losses * score * score
+                               + state.draws * (0.5 - score) * (0.5 - score)) / games;
+            double margin = 1.96 * std::sqrt(variance / games);
+            double elo = eloOf(score);
+            double eloMargin = (eloOf(score + margin) - eloOf(score - margin)) / 2;
+            int decisive = state.wins + state.losses;
+            double los = decisive > 0 ? 0.5 * (1 + std::erf((state.wins - state.losses) / std::sqrt(2.0 * decisive))) : 0.5;
+            cout << std::setprecision(1) << "Elo difference: " << elo << " +/- " << eloMargin
+                 << ", LOS: " << los * 100 << "%" << endl;
+        }
+
+        for(int i=0; i<2; ++i) {
+            double nodesPerSecond = state.seconds[i] > 0 ? state.nodes[i] / state.seconds[i] : 0;
+            cout << engines[i].name << ": " << static_cast<uint64_t>(nodesPerSecond) << " nodes/s ("
+                 << state.nodes[i] << " nodes in " << std::setprecision(1) << state.seconds[i] << " s)" << endl;
+        }
+    }
+
+    bool readOpenings(const string &fileName, vector<string> &openings) {
+        ifstream input(fileName.c_str());
+        if(!input.is_open())
+            return false;
+        string line;
+        while(std::getline(input, line)) {
+            if(!line.empty() && line.back() == '\r')
+                line.pop_back();
+            Board board;
+            if(!line.empty() && board.setFromFen(line))
+                openings.push_back(line);
+        }
+        return !openings.empty();
+    }
+}
+
+int main(int argc, char *argv[]) {
+    // A UCI engine that exits must end its games, not the match
+    signal(SIGPIPE, SIG_IGN);
+
+    string engineTexts[2] = { "self", "self" };
+    int games = 100;
+    int concurrency = static_cast<int>(std::thread::hardware_concurrency());
+    TimeControl timeControl = { 10000, 100, 0 };
+    string openingsFile;
+    bool sprt = false;
+    double elo0 = 0, elo1 = 5, alpha = 0.05, beta = 0.05;
+    int maxPlies = 400;
+
+    for(int i=1; i+1<argc; i+=2) {
+        string option = argv[i];
+        string value = argv[i + 1];
+        if(option == "--engine1")
+            engineTexts[0] = value;
+        else if(option == "--engine2")
+            engineTexts[1] = value;
+        else if(option == "--games")
+            games = atoi(value.c_str());
+        else if(option == "--concurrency")
+            concurrency = atoi(value.c_str());
+        else if(option == "--tc") {
+            size_t plus = value.find('+');
+            timeControl.time = atoi(value.substr(0, plus).c_str());
+            timeControl.increment = plus == string::npos ? 0 : atoi(value.substr(plus + 1).c_str());
+        }
+        else if(option == "--movetime")
+            timeControl.moveTime = atoi(value.c_str());
+        else if(option == "--openings")
+            openingsFile = value;
+        else if(option == "--sprt") {
+            size_t comma = value.find(',');
+            if(comma == string::npos) {
+                cerr << "--sprt needs <elo0>,<elo1>\n";
+                return 1;
+            }
+            sprt = true;
+            elo0 = atof(value.substr(0, comma).c_str());
+            elo1 = atof(value.substr(comma + 1).c_str());
+        }
+        else if(option == "--alpha")
+            alpha = atof(value.c_str());
+        else if(option == "--beta")
+            beta = atof(value.c_str());
+        else if(option == "--maxplies")
+            maxPlies = atoi(value.c_str());
+        else {
+            cerr << "Unknown option " << option << "\n";
+            return 1;
+        }
+    }
+    if(concurrency < 1)
+        concurrency = 1;
+    if(games < 1 || (timeControl.moveTime <= 0 && timeControl.time <= 0)) {
+        cerr << "Usage: match [--engine1 <spec>] [--engine2 <spec>] [--games <count>] [--concurrency <count>] "
+                "[--tc <ms>[+<ms>] | --movetime <ms>] [--openings <file>] [--sprt <elo0>,<elo1>] [--maxplies <count>]\n";
+        return 1;
+    }
+
+    EngineSpec engines[2];
+    vector<std::unique_ptr<Tablebases> > tablebases;
+    for(int i=0; i<2; ++i) {
+        if(!parseEngineSpec(engineTexts[i], "engine" + std::to_string(i + 1), engines[i], tablebases))
+            return 1;
+    }
+
+    vector<string> openings;
+    if(openingsFile.empty()) {
+        for(const char *fen : defaultOpenings)
+            openings.push_back(fen);
+    } else if(!readOpenings(openingsFile, openings)) {
+        cerr << "No positions in " << openingsFile << "\n";
+        return 1;
+    }
+
+    double lowerBound = std::log(beta / (1 - alpha));
+    double upperBound = std::log((1 - beta) / alpha);
+    cout << engines[0].name << ": " << engineTexts[0] << "\n" << engines[1].name << ": " << engineTexts[1] << "\n"
+         << games << " games, " << concurrency << " at a time, " << openings.size() << " openings, ";
+    if(timeControl.moveTime > 0)
+        cout << timeControl.moveTime << " ms per move" << endl;
+    else
+        cout << timeControl.time << "+" << timeControl.increment << " ms" << endl;
+
+    MatchState state;
+    std::mutex stateMutex;
+    std::atomic<int> nextGame(0);
+    std::atomic<bool> finished(false);
+    std::atomic<bool> startFailed(false);
+    int sprtVerdict = 0;    // 1 H1 accepted, -1 H0 accepted
+
+    // Each thread has its own two engines and plays its games one after the other
+    auto worker = [&]() {
+        std::unique_ptr<Player> players[2] = { makePlayer(engines[0]), makePlayer(engines[1]) };
+        for(int i=0; i<2; ++i) {
+            if(!players[i]->start()) {
+                std::lock_guard<std::mutex> lock(stateMutex);
+                if(!startFailed.exchange(true))
+                    cerr << "Can't start " << engines[i].name << ": " << engineTexts[i] << "\n";
+                finished = true;
+                return;
+            }
+        }
+        Player *gamePlayers[2] = { players[0].get(), players[1].get() };
+
+        while(!finished) {
+            int game = nextGame++;
+            if(game >= games)
+                break;
+
+            // Both colors of an opening are played one after the other
+            const string &fen = openings[(game / 2) % openings.size()];
+            bool engine1White = game % 2 == 0;
+            GameResult result = playGame(gamePlayers, engine1White, fen, timeControl, maxPlies);
+
+            std::lock_guard<std::mutex> lock(stateMutex);
+            if(result.score > 0) ++state.wins;
+            else if(result.score < 0) ++state.losses;
+            else ++state.draws;
+            for(int i=0; i<2; ++i) {
+                state.nodes[i] += result.nodes[i];
+                state.seconds[i] += result.seconds[i];
+            }
+
+            int whiteScore = engine1White ? result.score : -result.score;
+            cout << "Game " << game + 1 << " (" << (engine1White ? "engine1 white" : "engine2 white") << ", opening "
+                 << (game / 2) % openings.size() + 1 << "): "
+                 << (whiteScore > 0 ? "1-0" : whiteScore < 0 ? "0-1" : "1/2-1/2") << " " << result.reason
+                 << " | +" << state.wins << " -" << state.losses << " =" << state.draws;
+            if(sprt) {
+                double llr = likelihoodRatio(state, elo0, elo1);
+                cout << " | LLR " << std::fixed << std::setprecision(2) << llr << " [" << lowerBound << ", "
+                     << upperBound << "]";
+                if(llr >= upperBound || llr <= lowerBound) {
+                    sprtVerdict = llr >= upperBound ? 1 : -1;
+                    finished = true;
+                }
+            }
+            cout << endl;
+        }
+    };
+
+    vector<std::thread> threads;
+    for(int i=0; i<concurrency; ++i)
+        threads.push_back(std::thread(worker));
+    for(std::thread &thread : threads)
+        thread.join();
+    if(startFailed)
+        return 1;
+
+    printSummary(state, engines);
+    if(sprt) {
+        cout << std::setprecision(2) << "SPRT (elo0 " << elo0 << ", elo1 " << elo1 << ", alpha " << alpha << ", beta " << beta << "): ";
+        if(sprtVerdict > 0)
+            cout << "H1 accepted, " << engines[0].name << " is stronger" << endl;
+        else if(sprtVerdict < 0)
+            cout << "H0 accepted, " << engines[0].name << " is not " << elo1 << " Elo stronger" << endl;
+        else
+            cout << "inconclusive, LLR " << likelihoodRatio(state, elo0, elo1) << endl;
+    }
+    return 0;
+}
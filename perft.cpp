@@ -0,0 +1,476 @@
+/* Perft tool: counts the leaf nodes of the move tree to a given depth.
+ * The counts of the reference positions are known, so they check that the move generation is correct,
+ * and the nodes per second measure how fast it is on the same workload every time.
+ *
+ * Usage:
+ *   perft                          runs the reference positions up to depth 4
+ *   perft suite <depth>            runs the reference positions up to the given depth
+ *   perft <depth> [fen]            counts the nodes of the position (start position if no FEN is given)
+ *   perft divide <depth> [fen]     also prints the node count under each move of the position
+ *   perft pseudo <depth> [fen]     counts with the pseudo-legal moves, making each one and checking the King's safety
+ *   perft movepiece <depth> [fen]  counts by trying every from/to pair with movePiece, which checks isLegalMove and isLegal
+ *   perft hashed <depth> [fen]     counts with a table of the counts of positions already seen (by Zobrist key): the
+ *                                  tree under a position reached by different move orders is only walked the first
+ *                                  time, its count is reused the other times. Also times plain perft to compare.
+ *   perft status <depth> [fen]     checks hasLegalMove and gameStatus against the legal move generator in every
+ *                                  position of the tree (of the reference positions if no FEN is given)
+ *   perft fen                      checks setFromFen, toFen and toEpd, and the counters makeMove and unmakeMove keep */
+
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include "Board.h"
+
+using std::cerr;
+
+namespace {
+    const string startFen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+    // Well known positions with their node counts for depths 1 to 5 (from the Chess Programming Wiki)
+    struct ReferencePosition {
+        const char *name;
+        const char *fen;
+        uint64_t nodes[5];
+    };
+
+    const ReferencePosition referencePositions[] = {
+        { "start", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+          { 20, 400, 8902, 197281, 4865609 } },
+        { "kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+          { 48, 2039, 97862, 4085603, 193690690 } },
+        { "position3", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+          { 14, 191, 2812, 43238, 674624 } },
+        { "position4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+          { 6, 264, 9467, 422333, 15833292 } },
+        { "position5", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+          { 44, 1486, 62379, 2103487, 89941194 } },
+        { "position6", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+          { 46, 2079, 89890, 3894594, 164075551 } },
+    };
+
+    // Counts the leaf nodes using the legal move generator and makeMove/unmakeMove
+    uint64_t perft(Board &board, int depth) {
+        if(depth == 0)
+            return 1;
+
+        MoveList moveList;
+        board.generateLegalMoves(board.getSideToMove(), moveList);
+
+        // The moves of the last ply don't have to be made to be counted
+        if(depth == 1)
+            return moveList.count;
+
+        uint64_t nodes = 0;
+        for(int i=0; i<moveList.count; ++i) {
+            board.makeMove(moveList.moves[i]);
+            nodes += perft(board, depth - 1);
+            board.unmakeMove();
+        }
+        return nodes;
+    }
+
+    // Counts the leaf nodes the way it was done before the legal move generator: every pseudo-legal move is made and
+    // the ones that leave the King under attack are taken back without counting
+    uint64_t perftPseudo(Board &board, int depth) {
+        if(depth == 0)
+            return 1;
+
+        int color = board.getSideToMove();
+        MoveList moveList;
+        board.generateMoves(color, moveList);
+
+        uint64_t nodes = 0;
+        for(int i=0; i<moveList.count; ++i) {
+            board.makeMove(moveList.moves[i]);
+            // Pseudo-legal moves that leave the King under attack are not counted
+            if(board.isKingSafe(color) == 1)
+                nodes += perftPseudo(board, depth - 1);
+            board.unmakeMove();
+        }
+        return nodes;
+    }
+
+    // Node counts of positions already counted, indexed by the Zobrist key of the position.
+    // Every slot has the full key and the count with its depth packed in the top 8 bits, a new count replaces the old.
+    class PerftTable {
+    public:
+        explicit PerftTable(int megabytes) {
+            size_t count = 1;
+            while(count * 2 * sizeof(Slot) <= static_cast<size_t>(megabytes) * 1024 * 1024)
+                count *= 2;
+            slots.assign(count, Slot());
+            indexMask = count - 1;
+        }
+
+        bool probe(uint64_t key, int depth, uint64_t &nodes) const {
+            const Slot &slot = slots[key & indexMask];
+            if(slot.key != key || static_cast<int>(slot.data >> 56) != depth)
+                return false;
+            nodes = slot.data & ((1ULL << 56) - 1);
+            return true;
+        }
+
+        void store(uint64_t key, int depth, uint64_t nodes) {
+            Slot &slot = slots[key & indexMask];
+            slot.key = key;
+            slot.data = (static_cast<uint64_t>(depth) << 56) | nodes;
+        }
+
+    private:
+        struct Slot {
+            uint64_t key;
+            uint64_t data;
+
+            Slot() : key(0), data(0) {}
+        };
+
+        std::vector<Slot> slots;
+        uint64_t indexMask;
+    };
+
+    // Counts the leaf nodes like perft, but takes the count of a position from the table if it was counted before.
+    // The last ply is counted from the move list like perft does, a table lookup would cost more than that.
+    uint64_t perftHashed(Board &board, int depth, PerftTable &table) {
+        if(depth == 0)
+            return 1;
+
+        MoveList moveList;
+        uint64_t nodes = 0;
+        if(depth == 1) {
+            board.generateLegalMoves(board.getSideToMove(), moveList);
+            return moveList.count;
+        }
+        if(table.probe(board.getHashKey(), depth, nodes))
+            return nodes;
+
+        board.generateLegalMoves(board.getSideToMove(), moveList);
+        for(int i=0; i<moveList.count; ++i) {
+            board.makeMove(moveList.moves[i]);
+            nodes += perftHashed(board, depth - 1, table);
+            board.unmakeMove();
+        }
+
+        table.store(board.getHashKey(), depth, nodes);
+        return nodes;
+    }
+
+    // Counts the leaf nodes the way the game checks a typed move: movePiece on every from/to pair
+    uint64_t perftMovePiece(Board &board, int depth) {
+        if(depth == 0)
+            return 1;
+
+        const PieceType promotions[4] = { PieceType::Queen, PieceType::Rook, PieceType::Bishop, PieceType::Knight };
+        int color = board.getSideToMove();
+        uint64_t nodes = 0;
+
+        for(int from=0; from<64; ++from) {
+            Piece piece = board.getPiece(rowOf(from), colOf(from));
+            if(piece.getType() == PieceType::Empty || piece.getColor() != color)
+                continue;
+
+            for(int to=0; to<64; ++to) {
+                // A pawn reaching the last row can be promoted to four different pieces
+                bool promotion = piece.getType() == PieceType::Pawn && (rowOf(to) == 0 || rowOf(to) == 7);
+                for(int p=0; p < (promotion ? 4 : 1); ++p) {
+                    if(board.movePiece(rowOf(from), colOf(from), rowOf(to), colOf(to), promotions[p])) {
+                        nodes += perftMovePiece(board, depth - 1);
+                        board.revertMove();
+                    }
+                }
+            }
+        }
+        return nodes;
+    }
+
+    // Positions looked at by the game status check, the ones without a legal move, and the ones where hasLegalMove or
+    // gameStatus disagree with the legal move generator
+    struct StatusCounts {
+        uint64_t positions;
+        uint64_t checkmates;
+        uint64_t stalemates;
+        uint64_t mismatches;
+    };
+
+    // Visits every position of the tree down to depth, the last ply included. hasLegalMove must be true exactly when
+    // generateLegalMoves finds a move, and without one gameStatus must be checkmate if the King is attacked and
+    // stalemate if it isn't. The first positions that disagree are printed as FEN.
+    void checkStatus(Board &board, int depth, StatusCounts &counts) {
+        int color = board.getSideToMove();
+        MoveList moveList;
+        board.generateLegalMoves(color, moveList);
+
+        GameStatus expected = GameStatus::Ongoing;
+        if(moveList.count == 0) {
+            bool inCheck = board.attackerCount(board.getKingSquare(color), 1 - color) > 0;
+            expected = inCheck ? GameStatus::Checkmate : GameStatus::Stalemate;
+            ++(inCheck ? counts.checkmates : counts.stalemates);
+        }
+        ++counts.positions;
+        if(board.hasLegalMove(color) != (moveList.count > 0) || board.gameStatus(color) != expected) {
+            if(counts.mismatches < 10)
+                cout << "  MISMATCH: " << board.toFen() << endl;
+            ++counts.mismatches;
+        }
+
+        if(depth == 0)
+            return;
+        for(int i=0; i<moveList.count; ++i) {
+            board.makeMove(moveList.moves[i]);
+            checkStatus(board, depth - 1, counts);
+            board.unmakeMove();
+        }
+    }
+
+    double secondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void printResult(const string &label, uint64_t nodes, double seconds) {
+        uint64_t nodesPerSecond = seconds > 0 ? static_cast<uint64_t>(nodes / seconds) : 0;
+        cout << label << ": " << nodes << " nodes, " << std::fixed << std::setprecision(3) << seconds << " s, "
+             << nodesPerSecond << " nodes/s" << endl;
+    }
+
+    // Runs every reference position up to maxDepth, returns false if any count is wrong
+    bool runSuite(int maxDepth) {
+        bool allCorrect = true;
+        uint64_t totalNodes = 0;
+        double totalSeconds = 0;
+
+        for(const ReferencePosition &position : referencePositions) {
+            Board board;
+            board.setFromFen(position.fen);
+            cout << position.name << " (" << position.fen << ")" << endl;
+
+            for(int depth=1; depth<=maxDepth && depth<=5; ++depth) {
+                auto start = std::chrono::steady_clock::now();
+                uint64_t nodes = perft(board, depth);
+                double seconds = secondsSince(start);
+                totalNodes += nodes;
+                totalSeconds += seconds;
+
+                printResult("depth " + std::to_string(depth), nodes, seconds);
+                if(nodes != position.nodes[depth - 1]) {
+                    cout << "  WRONG, expected " << position.nodes[depth - 1] << " nodes" << endl;
+                    allCorrect = false;
+                }
+            }
+        }
+
+        cout << endl;
+        printResult("Total", totalNodes, totalSeconds);
+        cout << (allCorrect ? "All node counts are correct." : "Some node counts are WRONG.") << endl;
+        return allCorrect;
+    }
+
+    // The reference positions' trees have checkmates but no stalemates, these have both a few plies in
+    const char *statusPositions[][2] = {
+        { "queen stalemates", "k7/8/1Q6/8/8/8/8/7K w - - 0 1" },
+        { "pawn stalemates", "7k/5K2/6P1/8/8/8/8/8 w - - 0 1" },
+    };
+
+    // Runs the game status check on the position, or on every reference position and the status positions if fen is
+    // empty. Returns false if any position disagrees.
+    bool runStatusCheck(int depth, const string &fen) {
+        vector<std::pair<string, string> > positions;
+        if(fen.empty()) {
+            for(const ReferencePosition &position : referencePositions)
+                positions.push_back(std::make_pair(string(position.name), string(position.fen)));
+            for(const auto &position : statusPositions)
+                positions.push_back(std::make_pair(string(position[0]), string(position[1])));
+        } else {
+            positions.push_back(std::make_pair(string("position"), fen));
+        }
+
+        StatusCounts total = { 0, 0, 0, 0 };
+        auto start = std::chrono::steady_clock::now();
+        for(const auto &position : positions) {
+            Board board;
+            if(!board.setFromFen(position.second)) {
+                cerr << "Invalid FEN: " << position.second << "\n";
+                return false;
+            }
+
+            StatusCounts counts = { 0, 0, 0, 0 };
+            checkStatus(board, depth, counts);
+            cout << position.first << ": " << counts.positions << " positions, " << counts.checkmates << " checkmates, "
+                 << counts.stalemates << " stalemates, " << counts.mismatches << " mismatches" << endl;
+            total.positions += counts.positions;
+            total.checkmates += counts.checkmates;
+            total.stalemates += counts.stalemates;
+            total.mismatches += counts.mismatches;
+        }
+
+        cout << endl;
+        printResult("Total", total.positions, secondsSince(start));
+        cout << (total.mismatches == 0 ? "hasLegalMove and gameStatus agree with the legal move generator."
+                                       : "hasLegalMove or gameStatus DISAGREE with the legal move generator.") << endl;
+        return total.mismatches == 0;
+    }
+
+    // A position, moves to make from it (coordinate notation, separated by spaces) and the FEN expected after them
+    struct FenCase {
+        const char *fen;
+        const char *moves;
+        const char *expected;
+    };
+
+    const FenCase fenCases[] = {
+        // Quiet moves count for the fifty-move rule, a full move ends with black's move
+        { "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", "g1f3 g8f6",
+          "rnbqkb1r/pppppppp/5n2/8/8/5N2/PPPPPPPP/RNBQKB1R w KQkq - 2 2" },
+        // A pawn's two squares move sets the en passant square, and an en passant capture takes the pawn beside it
+        { "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", "e2e4",
+          "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1" },
+        { "rnbqkbnr/ppp1pppp/8/8/3p4/8/PPPPPPPP/RNBQKBNR w KQkq - 0 3", "e2e4 d4e3",
+          "rnbqkbnr/ppp1pppp/8/8/8/4p3/PPPP1PPP/RNBQKBNR w KQkq - 0 4" },
+        // Captures and pawn moves start the count again, a promotion without a capture too
+        { "8/4P3/8/8/8/8/k7/4K3 w - - 7 40", "e7e8q", "4Q3/8/8/8/8/8/k7/4K3 b - - 0 40" },
+        { "3r4/4P3/8/8/8/8/k7/4K3 w - - 7 40", "e7d8n", "3N4/8/8/8/8/8/k7/4K3 b - - 0 40" },
+        { "4k3/8/8/8/8/8/8/R3K2R w KQ - 12 30", "e1g1", "4k3/8/8/8/8/8/8/R4RK1 b - - 13 30" },
+    };
+
+    // FENs that setFromFen has to refuse, the board can't hold these positions
+    const char *invalidFens[] = {
+        "rnbq1bnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQ - 0 1",       // No black King
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKKNR w kq - 0 1",       // Two white Kings
+        "4k3/8/8/8/8/QQQQQQQQ/PPPPPPPP/RNBQKBNR w - - 0 1",             // 17 white pieces
+        "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR w KQkq e3 0 1",  // En passant on rank 3 with white to move
+        "rnbqkbnr/pppp1ppp/8/4p3/8/8/PPPPPPPP/RNBQKBNR b KQkq e6 0 1",  // En passant on rank 6 with black to move
+        "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e4 0 1",  // En passant on a square no pawn skips
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBN w KQkq - 0 1",      // A row of 7 squares
+    };
+
+    // Checks every FEN case: the FEN is read back the same, the moves give the expected FEN, the EPD of the result is
+    // read back the same, and taking the moves back gives the starting FEN. Then every invalid FEN has to be refused
+    // without changing the board. Returns false if any check fails.
+    bool runFenCheck() {
+        int failed = 0;
+        for(const FenCase &fenCase : fenCases) {
+            Board board;
+            string result;
+            if(!board.setFromFen(fenCase.fen)) {
+                result = "not read";
+            } else if(board.toFen() != fenCase.fen) {
+                result = "read back as " + board.toFen();
+            } else {
+                std::istringstream moves(fenCase.moves);
+                string notation;
+                int made = 0;
+                while(result.empty() && moves >> notation) {
+                    Move move;
+                    if(board.parseMove(notation, move)) {
+                        board.makeMove(move);
+                        ++made;
+                    } else {
+                        result = "can't play " + notation;
+                    }
+                }
+
+                Board fromEpd;
+                if(!result.empty()) {
+                } else if(board.toFen() != fenCase.expected) {
+                    result = "gave " + board.toFen();
+                } else if(!fromEpd.setFromFen(board.toEpd()) || fromEpd.toFen() != fenCase.expected) {
+                    result = "EPD " + board.toEpd() + " read back as " + fromEpd.toFen();
+                } else {
+                    for(int i=0; i<made; ++i)
+                        board.unmakeMove();
+                    if(board.toFen() != fenCase.fen)
+                        result = "taken back to " + board.toFen();
+                }
+            }
+
+            cout << fenCase.fen << " [" << fenCase.moves << "]: " << (result.empty() ? "correct" : "WRONG, " + result)
+                 << endl;
+            failed += !result.empty();
+        }
+
+        for(const char *fen : invalidFens) {
+            Board board;
+            string before = board.toFen();
+            bool refused = !board.setFromFen(fen) && board.toFen() == before;
+            cout << fen << ": " << (refused ? "refused" : "WRONG, accepted") << endl;
+            failed += !refused;
+        }
+
+        cout << endl << (failed == 0 ? "All FEN checks are correct." : "Some FEN checks are WRONG.") << endl;
+        return failed == 0;
+    }
+
+    // Joins the command line arguments from index first on, since a FEN string has spaces in it
+    string joinArguments(int argc, char *argv[], int first) {
+        string joined;
+        for(int i=first; i<argc; ++i) {
+            if(!joined.empty())
+                joined += ' ';
+            joined += argv[i];
+        }
+        return joined;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    string mode = argc > 1 ? argv[1] : "suite";
+
+    if(mode == "suite")
+        return runSuite(argc > 2 ? atoi(argv[2]) : 4) ? 0 : 1;
+    if(mode == "fen")
+        return runFenCheck() ? 0 : 1;
+
+    // The depth comes after the mode name, or first if only a depth is given
+    int depthIndex = (mode == "divide" || mode == "pseudo" || mode == "movepiece" || mode == "hashed"
+                      || mode == "status") ? 2 : 1;
+    int depth = argc > depthIndex ? atoi(argv[depthIndex]) : 0;
+    if(depth < 1) {
+        cerr << "Usage: perft [suite <depth> | <depth> [fen] | divide <depth> [fen] | pseudo <depth> [fen] | movepiece <depth> [fen] | hashed <depth> [fen] | status <depth> [fen]]\n";
+        return 1;
+    }
+
+    string fen = joinArguments(argc, argv, depthIndex + 1);
+    if(mode == "status")
+        return runStatusCheck(depth, fen) ? 0 : 1;
+
+    Board board;
+    if(!board.setFromFen(fen.empty() ? startFen : fen)) {
+        cerr << "Invalid FEN: " << fen << "\n";
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t nodes = 0;
+
+    if(mode == "divide") {
+        MoveList moveList;
+        board.generateLegalMoves(board.getSideToMove(), moveList);
+
+        for(int i=0; i<moveList.count; ++i) {
+            board.makeMove(moveList.moves[i]);
+            uint64_t moveNodes = perft(board, depth - 1);
+            cout << moveToString(moveList.moves[i]) << ": " << moveNodes << endl;
+            nodes += moveNodes;
+            board.unmakeMove();
+        }
+        cout << endl;
+    } else if(mode == "pseudo") {
+        nodes = perftPseudo(board, depth);
+    } else if(mode == "movepiece") {
+        nodes = perftMovePiece(board, depth);
+    } else if(mode == "hashed") {
+        // Plain perft first, so the gain of the table shows next to it
+        uint64_t plainNodes = perft(board, depth);
+        printResult("plain  depth " + std::to_string(depth), plainNodes, secondsSince(start));
+        PerftTable table(64);
+        start = std::chrono::steady_clock::now();
+        nodes = perftHashed(board, depth, table);
+        printResult("hashed depth " + std::to_string(depth), nodes, secondsSince(start));
+        return 0;
+    } else {
+        nodes = perft(board, depth);
+    }
+
+    printResult("depth " + std::to_string(depth), nodes, secondsSince(start));
+    return 0;
+}